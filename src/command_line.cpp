@@ -1,4 +1,6 @@
 #include "command_line.h"
+#include "plot_stream.h"
+#include "render.h"
 #include <iostream> // std::cout
 #include <cstdlib>  // std::exit()
 #include <boost/program_options.hpp>
@@ -12,6 +14,49 @@ boost::program_options::options_description get_descriptions()
     desc.add_options()
         ("help,h", "produce help message")
         ("file,f", "XML file to parse")
+        ("parser", po::value<std::string>()->default_value("dom"),
+         "extraction method: dom (build a rapidxml DOM), compact (index-based DOM in "
+         "document order), sax (parse events, no DOM), "
+         "schema (single pass specialised for the ppcPlot grammar), index (SIMD "
+         "structural index of the whole file, then a walk over it) or parallel "
+         "(DOM per range of root children, one thread each)")
+        ("threads", po::value<unsigned>()->default_value(0),
+         "threads for --parser parallel and for reading plot archives, 0 for one "
+         "per hardware thread")
+        ("fixed-scale", po::value<int>()->default_value(0),
+         "store coordinates as 16-bit multiples of 1/N while they all fit exactly "
+         "(falls back to doubles otherwise), 0 to always store doubles")
+        ("cache-dir", po::value<std::string>()->default_value(""),
+         "directory of parsed scenes reused while the plot file is unchanged "
+         "(default $XDG_CACHE_HOME/level4 or ~/.cache/level4)")
+        ("no-cache", "always parse the plot file, and do not store the result")
+        ("pack", po::value<std::string>(),
+         "also write the plot as a compressed plot archive to this file; archives "
+         "are recognised and read in place of XML whatever --parser says")
+        ("width", po::value<int>()->default_value(1000),
+         "image width in pixels; with --fit, 0 sizes it to the plot at --scale")
+        ("height", po::value<int>()->default_value(1000),
+         "image height in pixels; with --fit, 0 sizes it to the plot at --scale")
+        ("origin-x", po::value<double>()->default_value(0),
+         "plot x coordinate of the left edge of the image")
+        ("origin-y", po::value<double>()->default_value(0),
+         "plot y coordinate of the bottom edge of the image")
+        ("scale", po::value<double>()->default_value(1),
+         "image pixels per plot unit")
+        ("fit", "center the whole plot on the image, choosing the origin, and the "
+         "scale too unless --width or --height is 0")
+        ("render-threads", po::value<unsigned>()->default_value(0),
+         "threads drawing tiles of the image, 0 for one per hardware thread, "
+         "1 to draw every primitive in turn without tiles")
+        ("tile", po::value<int>()->default_value(TileRenderer::DEFAULT_TILE),
+         "tile size in pixels for --render-threads other than 1")
+        ("stamp-cache", po::value<size_t>()->default_value(StampCache::DEFAULT_BUDGET),
+         "bytes of pre-rasterised arc shapes kept for reuse, shared by the render "
+         "threads; 0 to rasterise every arc")
+        ("stream", "stream the file through a fixed-size window instead of loading it whole;"
+         " the file is read more than once, so it must be a regular file")
+        ("window", po::value<size_t>()->default_value(PlotStream::DEFAULT_WINDOW),
+         "stream window size in bytes")
         ;
     // clang-format on
     return desc;
@@ -0,0 +1,132 @@
+#include "decimal.h"
+#include <clocale>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// Powers of ten that are exactly representable as doubles.
+const double EXACT_POWERS[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int MAX_EXACT_POWER = 22;
+const std::uint64_t MAX_EXACT_MANTISSA = std::uint64_t(1) << 53;
+const int MAX_DIGITS = 19; // always fits in a uint64_t
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Null if the C locale could not be created.
+locale_t c_locale() {
+    static locale_t locale = newlocale(LC_ALL_MASK, "C", locale_t(0));
+    return locale;
+}
+
+// Correctly rounded, but needs a zero-terminated copy and is much slower.
+bool parse_slow(const char* first, const char* last, double& value) {
+    const std::size_t size = last - first;
+    char local[128];
+    std::unique_ptr<char[]> heap;
+    char* buf = local;
+    if (size >= sizeof(local)) {
+        heap.reset(new char[size + 1]);
+        buf = heap.get();
+    }
+    memcpy(buf, first, size);
+    buf[size] = 0;
+    char* end;
+    // Without a C locale, strtod() in the global one is the best there is;
+    // the program never changes it from "C".
+    const locale_t locale = c_locale();
+    const double result = locale ? strtod_l(buf, &end, locale) : strtod(buf, &end);
+    if (end != buf + size) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+} // namespace
+
+bool parse_decimal(const char* first, const char* last, double& value) {
+    const char* p = first;
+    const bool negative = p < last && *p == '-';
+    if (p < last && (*p == '-' || *p == '+')) {
+        ++p;
+    }
+
+    // Significand: keep up to MAX_DIGITS significant digits, noting whether
+    // any non-zero digit had to be dropped.
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool any = false;
+    for (; p < last && is_digit(*p); ++p) {
+        any = true;
+        if (digits < MAX_DIGITS) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            truncated |= *p != '0';
+        }
+    }
+    if (p < last && *p == '.') {
+        for (++p; p < last && is_digit(*p); ++p) {
+            any = true;
+            if (digits < MAX_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else {
+                truncated |= *p != '0';
+            }
+        }
+    }
+    if (!any) {
+        return false;
+    }
+
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        ++p;
+        const bool negative_exp = p < last && *p == '-';
+        if (p < last && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        if (p == last || !is_digit(*p)) {
+            return false;
+        }
+        int exp = 0;
+        for (; p < last && is_digit(*p); ++p) {
+            if (exp < 100000) {
+                exp = exp * 10 + (*p - '0');
+            }
+        }
+        exponent += negative_exp ? -exp : exp;
+    }
+    if (p != last) {
+        return false;
+    }
+
+    if (mantissa == 0 && !truncated) {
+        value = negative ? -0.0 : 0.0;
+        return true;
+    }
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA &&
+        exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= EXACT_POWERS[-exponent];
+        } else {
+            result *= EXACT_POWERS[exponent];
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+    return parse_slow(first, last, value);
+}
@@ -0,0 +1,18 @@
+#ifndef DECIMAL__H_
+#define DECIMAL__H_
+
+#include <cstddef>
+
+// Parses the decimal number in [first, last), e.g. "483.2", "-60" or "1e3",
+// into value, correctly rounded and independent of the current locale.  The
+// whole range must be the number: no whitespace, hex or inf/nan.  Returns
+// false, leaving value untouched, if it is not a valid number.
+//
+// Numbers with at most 19 significant digits whose value is an exact integer
+// times or divided by a power of ten up to 1e22 (every coordinate in our plot
+// files) are computed with a single IEEE multiply or divide, which is exact
+// followed by one rounding.  Anything else falls back to strtod_l() in the C
+// locale, or to strtod() should that locale be unavailable.
+bool parse_decimal(const char* first, const char* last, double& value);
+
+#endif // DECIMAL__H_
@@ -1,164 +1,158 @@
 #include <iostream>
 #include <string>
-#include <fstream>
 #include <vector>
 #include <cstring>
 #include <cassert>
 #include <limits>
 #include <boost/program_options.hpp>
 #include "rapidxml.hpp"
+#include "rapidxml_compact.hpp"
 #include "command_line.h"
+#include "mapped_file.h"
+#include "plot_archive.h"
+#include "plot.h"
+#include "plot_index.h"
+#include "plot_parallel.h"
+#include "plot_schema.h"
+#include "plot_stream.h"
+#include "render.h"
+#include "scene.h"
+#include "scene_cache.h"
+#include "stamp_cache.h"
 #include <opencv2/opencv.hpp>
+#include <sys/stat.h>
 
-enum class Color {
-    Blue,
-    Green,
-    Red,
-    Yellow,
-    White
-};
+// Names and values are only read through name_ref()/value_ref(), so the
+// document is parsed non-destructively, straight from a read-only mapping.
+void load_plot(const std::string& filename, Scene& scene) {
+    using namespace std;
+    namespace xml = rapidxml;
 
-Color translate_color(const char* val) {
-    if (strncmp(val, "yellow", strlen("yellow")) == 0) {
-        return Color::Yellow;
-    } else if (strncmp(val, "green", strlen("green")) == 0) {
-        return Color::Green;
-    } else if (strncmp(val, "red", strlen("red")) == 0) {
-        return Color::Red;
-    } else if (strncmp(val, "white", strlen("white")) == 0) {
-        return Color::White;
-    } else if (strncmp(val, "blue", strlen("blue")) == 0) {
-        return Color::Blue;
-    } else {
-        assert(0); // should not get here
-        return Color::White;
+    MappedFile file;
+    if (!file.open(filename, false)) {
+        cerr << "Unable to open: " << filename << endl;
+        ::exit(1);
     }
-}
 
-cv::Scalar color_to_scalar(Color color) {
-    switch (color) {
-    case Color::Blue:
-        return CV_RGB(0, 0, 255);
-    case Color::Green:
-        return CV_RGB(0, 204, 0);
-    case Color::Red:
-        return CV_RGB(255, 0, 0);
-    case Color::Yellow:
-        return CV_RGB(204, 204, 0);
-    case Color::White:
-    default:
-        return CV_RGB(255, 255, 255);
+    // Every element is a node, and so is the value of each leaf element.  The
+    // whole arena is one block, so it can be backed by huge pages.
+    const PlotCounts counts = count_plot(file.data(), file.size());
+    scene.reserve(scene.line_count() + counts.lines, scene.arc_count() + counts.arcs);
+    xml::xml_document<> doc;
+    doc.set_huge_pages(true);
+    doc.reserve(2 * counts.elements * sizeof(xml::xml_node<>));
+    doc.parse<xml::parse_non_destructive>(file.data());
+    if (!doc.first_node()) {
+        cerr << "No root element in: " << filename << endl;
+        ::exit(1);
     }
-}
 
-std::string color_to_string(Color color) {
-    switch (color) {
-    case Color::Blue:
-        return "blue";
-    case Color::Green:
-        return "green";
-    case Color::Red:
-        return "red";
-    case Color::Yellow:
-        return "yellow";
-    case Color::White:
-    default: // not sure why g++ can't tell that there are no other exit points
-        return "white";
+    xml::xml_node<> *root = doc.first_node();
+    const auto root_name = root->name_ref();
+    cout << "Name of first node is: " << string(root_name.begin(), root_name.end()) << endl;
+
+    for (xml::xml_node<> *node = root->first_node(); node; node = node->next_sibling()) {
+        const auto name = node->name_ref();
+        switch (element_kind(name.data(), name.size())) {
+        case Element::Line:
+            scene.add(parse_line(node));
+            break;
+        case Element::Arc:
+            scene.add(parse_arc(node));
+            break;
+        default:
+            cerr << "Unknown element: " << string(name.begin(), name.end()) << endl;
+            ::exit(1);
+        }
     }
 }
 
-struct Line {
-    Line()
-        : x_start(0.0)
-        , x_end(0.0)
-        , y_start(0.0)
-        , y_end(0.0)
-        , color(Color::White)
-        {}
+// Same as load_plot(), on a compact_document.
+void load_plot_compact(const std::string& filename, Scene& scene) {
+    using namespace std;
+    namespace xml = rapidxml;
 
-    Line(double x1, double x2, double y1, double y2, Color c=Color::White)
-        : x_start(x1)
-        , x_end(x2)
-        , y_start(y1)
-        , y_end(y2)
-        , color(c)
-        {}
-    
-    double x_start;
-    double x_end;
-    double y_start;
-    double y_end;
-    Color color;
-};
-std::ostream& operator<<(std::ostream& os, const Line& line) {
-    os << "Line("
-       << line.x_start << ", "
-       << line.x_end << ", "
-       << line.y_start << ", "
-       << line.y_end << ", "
-       << color_to_string(line.color)
-       << ")";
-    return os;
-}
+    MappedFile file;
+    if (!file.open(filename, false)) {
+        cerr << "Unable to open: " << filename << endl;
+        ::exit(1);
+    }
 
-struct Arc {
-    Arc()
-        : x_center(0.0)
-        , y_center(0.0)
-        , radius(0.0)
-        , arc_start(0.0)
-        , arc_extend(0.0)
-        , color(Color::White)
-        {}
+    const PlotCounts counts = count_plot(file.data(), file.size());
+    scene.reserve(scene.line_count() + counts.lines, scene.arc_count() + counts.arcs);
+    xml::compact_document<> doc;
+    doc.reserve(counts.elements);
+    doc.parse<xml::parse_non_destructive>(file.data());
+    const auto root = doc.first_node();
+    if (root == doc.npos) {
+        cerr << "No root element in: " << filename << endl;
+        ::exit(1);
+    }
 
-    Arc(double x, double y, double r, double s, double e, Color c=Color::White)
-        : x_center(x)
-        , y_center(y)
-        , radius(r)
-        , arc_start(s)
-        , arc_extend(e)
-        , color(c)
-        {}
-    
-    double x_center;
-    double y_center;
-    double radius;
-    double arc_start;
-    double arc_extend;
-    Color color;
-};
-std::ostream& operator<<(std::ostream& os, const Arc& arc) {
-    os << "Arc("
-       << arc.x_center << ", "
-       << arc.y_center << ", "
-       << arc.radius << ", "
-       << arc.arc_start << ", "
-       << arc.arc_extend << ", "
-       << color_to_string(arc.color)
-       << ")";
-    return os;
+    for (auto node = doc.first_node(root); node != doc.npos; node = doc.next_sibling(node)) {
+        switch (element_kind(doc.name(node), doc.name_size(node))) {
+        case Element::Line:
+            scene.add(parse_line(doc, node));
+            break;
+        case Element::Arc:
+            scene.add(parse_arc(doc, node));
+            break;
+        default:
+            cerr << "Unknown element: " << string(doc.name(node), doc.name_size(node)) << endl;
+            ::exit(1);
+        }
+    }
 }
 
-void drawline(cv::Mat& image, const size_t HEIGHT, const Line& line) {
-    cv::Point2f start(line.x_start, HEIGHT - line.y_start);
-    cv::Point2f end(line.x_end, HEIGHT - line.y_end);
-    cv::line(image, start, end, color_to_scalar(line.color));
+void load_plot_direct(const std::string& filename, const std::string& parser,
+                      unsigned threads, Scene& scene) {
+    using namespace std;
+    namespace xml = rapidxml;
+
+    // Only the parallel parser writes into the text (it borrows terminators).
+    MappedFile file;
+    if (!file.open(filename, parser == "parallel")) {
+        cerr << "Unable to open: " << filename << endl;
+        ::exit(1);
+    }
+
+    try {
+        if (parser == "sax") {
+            PlotBuilder builder(scene);
+            xml::xml_document<>::parse_sax<xml::parse_non_destructive>(file.data(), builder);
+        } else if (parser == "index") {
+            parse_plot_indexed(file.data(), file.size(), scene);
+        } else if (parser == "parallel") {
+            parse_plot_parallel(file.data(), file.size(), threads, scene);
+        } else {
+            parse_plot_schema(file.data(), file.size(), scene);
+        }
+    } catch (const xml::parse_error& ex) {
+        cerr << "Parse error: " << ex.what() << " at offset "
+             << ex.where<char>() - file.data() << endl;
+        ::exit(1);
+    }
 }
-void drawarc(cv::Mat& image, const size_t HEIGHT, const Arc& arc) {
-    cv::Point2f center(arc.x_center, HEIGHT - arc.y_center);
-    cv::Size axes(arc.radius, arc.radius);
-    cv::ellipse(image,
-                center,
-                axes,
-                0,
-                360. - arc.arc_start,
-                360. - (arc.arc_start + arc.arc_extend),
-                color_to_scalar(arc.color));    
+
+// A black image the size of canvas.
+cv::Mat make_image(const Canvas& canvas) {
+    using namespace std;
+
+    if (!Canvas(canvas.width, canvas.height).valid()) {
+        cerr << "Canvas size out of range: " << canvas.width << "x" << canvas.height
+             << " (at most " << Canvas::MAX_SIDE << " a side)" << endl;
+        ::exit(1);
+    }
+    if (!canvas.valid()) {
+        cerr << "Canvas origin or scale out of range: (" << canvas.x_origin << ", "
+             << canvas.y_origin << ") at " << canvas.scale << endl;
+        ::exit(1);
+    }
+    return cv::Mat(canvas.height, canvas.width, CV_8UC3, cv::Scalar(0));
 }
 
 int main(int argc, char **argv) {
     using namespace std;
-    namespace xml = rapidxml;
     const auto vm = parse_cmdline(argc, argv);
 
     if (!vm.count("file")) {
@@ -169,90 +163,122 @@ int main(int argc, char **argv) {
     const auto filename = vm["file"].as<std::string>();
     cout << "File: " << filename << endl;
 
-    ifstream ifs(filename.c_str(), ios::in);
-    if (!ifs) {
-        cerr << "Unable to open: " << filename << endl;
+    const Canvas requested(vm["width"].as<int>(), vm["height"].as<int>(),
+                           vm["origin-x"].as<double>(), vm["origin-y"].as<double>(),
+                           vm["scale"].as<double>());
+    const bool fit = vm.count("fit") != 0;
+    if (!(requested.scale > 0)) {
+        cerr << "--scale must be positive" << endl;
         ::exit(1);
     }
-    string text;
-    string line;
-    while (getline(ifs, line)) text += line;
-    ifs.close();
-
-    std::unique_ptr<char[]> buffer(new char[text.size() + 1]);
-    memcpy(buffer.get(), text.c_str(), text.size());
-    buffer[text.size()] = 0;
+    cv::Mat image;
+    const size_t stamp_budget = vm["stamp-cache"].as<size_t>();
+    size_t stamp_hits = 0;
+    size_t stamp_misses = 0;
 
-    xml::xml_document<> doc;
-    doc.parse<0>(buffer.get());
-
-    cout << "Name of first node is: " << doc.first_node()->name() << endl;
-    xml::xml_node<> *root = doc.first_node();
-
-    vector<Line> lines;
-    vector<Arc> arcs;
-    
-    const string LINE = "Line";
-    const string ARC = "Arc";
-    for (xml::xml_node<> *node = root->first_node(); node; node = node->next_sibling()) {
-        if (node->name() == LINE) {
-            Line line;
-            for (xml::xml_node<> *child = node->first_node(); child; child = child->next_sibling()) {
-                const string name = child->name();
-                if (name == "XStart") {
-                    line.x_start = stod(child->value());
-                } else if (name == "XEnd") {
-                    line.x_end = stod(child->value());
-                } else if (name == "YStart") {
-                    line.y_start = stod(child->value());
-                } else if (name == "YEnd") {
-                    line.y_end = stod(child->value());
-                } else if (name == "Color") {
-                    line.color = translate_color(child->value());
-                } else {
-                    cout << "Unknown line child: " << name << endl;
-                    assert(0);
-                }
+    if (vm.count("stream")) {
+        // Primitives are drawn as they are read and never stored.  Lines and
+        // arcs are streamed in separate passes to keep the painter's order of
+        // the in-memory path (all lines, then all arcs).  Pipes and the like
+        // can only be read once, so they are turned away up front rather than
+        // coming up empty on the second pass.
+        struct stat st;
+        if (::stat(filename.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+            cerr << "--stream reads the file more than once and needs a regular file: "
+                 << filename << endl;
+            ::exit(1);
+        }
+        PlotStream stream(vm["window"].as<size_t>());
+        Canvas canvas = requested;
+        if (fit) {
+            // One more pass, for the bounds.
+            Bounds bounds;
+            if (!stream.run(filename,
+                            [&](const Line& line) { bounds.include(line); },
+                            [&](const Arc& arc) { bounds.include(arc); })) {
+                cerr << stream.error() << endl;
+                ::exit(1);
             }
-            lines.push_back(std::move(line));
-        } else if (node->name() == ARC) {
-            Arc arc;
-            for (xml::xml_node<> *child = node->first_node(); child; child = child->next_sibling()) {
-                const string name = child->name();
-                if (name == "XCenter") {
-                    arc.x_center = stod(child->value());
-                } else if (name == "YCenter") {
-                    arc.y_center = stod(child->value());
-                } else if (name == "Radius") {
-                    arc.radius = stod(child->value());
-                } else if (name == "ArcStart") {
-                    arc.arc_start = stod(child->value());
-                } else if (name == "ArcExtend") {
-                    arc.arc_extend = stod(child->value());
-                } else if (name == "Color") {
-                    arc.color = translate_color(child->value());
-                } else {
-                    cout << "Unknown arc child: " << name << endl;
-                    assert(0);
+            canvas = Canvas::fit(bounds, requested.width, requested.height, requested.scale);
+        }
+        image = make_image(canvas);
+        StampCache stamps(stamp_budget);
+        const bool ok =
+            stream.run(filename,
+                       [&](const Line& line) { drawline(image, to_image(line, canvas)); },
+                       nullptr) &&
+            stream.run(filename,
+                       nullptr,
+                       [&](const Arc& arc) { drawarc(image, to_image(arc, canvas), stamps); });
+        if (!ok) {
+            cerr << stream.error() << endl;
+            ::exit(1);
+        }
+        stamp_hits = stamps.hits();
+        stamp_misses = stamps.misses();
+    } else {
+        const int scale = vm["fixed-scale"].as<int>();
+        if (scale < 0) {
+            cerr << "--fixed-scale must not be negative" << endl;
+            ::exit(1);
+        }
+        Scene scene = scale ? Scene(scale) : Scene();
+        std::string cache_dir = vm["cache-dir"].as<std::string>();
+        if (vm.count("no-cache")) {
+            cache_dir.clear();
+        } else if (cache_dir.empty()) {
+            cache_dir = SceneCache::default_directory();
+        }
+        const SceneCache cache(cache_dir);
+        if (!cache.load(filename, scene)) {
+            const auto parser = vm["parser"].as<std::string>();
+            if (PlotArchive::is_archive(filename)) {
+                PlotArchive archive;
+                if (!archive.read(filename, vm["threads"].as<unsigned>(), scene)) {
+                    cerr << archive.error() << endl;
+                    ::exit(1);
                 }
+            } else if (parser == "dom") {
+                load_plot(filename, scene);
+            } else if (parser == "compact") {
+                load_plot_compact(filename, scene);
+            } else if (parser == "sax" || parser == "schema" || parser == "index" ||
+                       parser == "parallel") {
+                load_plot_direct(filename, parser, vm["threads"].as<unsigned>(), scene);
+            } else {
+                cerr << "Unknown parser: " << parser << endl;
+                ::exit(1);
+            }
+            cache.store(filename, scene);
+        }
+        if (vm.count("pack")) {
+            PlotArchive archive;
+            if (!archive.write(vm["pack"].as<std::string>(), scene)) {
+                cerr << archive.error() << endl;
+                ::exit(1);
             }
-            arcs.push_back(std::move(arc));
-        } else {
-            cerr << "Unknown element: " << node->name() << endl;
-            ::exit(1);
         }
-    }
 
-    const size_t WIDTH = 1000;
-    const size_t HEIGHT = 1000;
-    cv::Mat image(WIDTH, HEIGHT, CV_8UC3, cv::Scalar(0));
-    
-    for (const auto& line: lines) {
-        drawline(image, HEIGHT, line);
-    }
-    for (auto& arc: arcs) {
-        drawarc(image, HEIGHT, arc);
+        const Canvas canvas =
+            fit ? Canvas::fit(scene.bounds(), requested.width, requested.height, requested.scale)
+                : requested;
+        image = make_image(canvas);
+        scene.to_image(canvas);
+        const unsigned render_threads = vm["render-threads"].as<unsigned>();
+        if (render_threads == 1) {
+            StampCache stamps(stamp_budget);
+            drawlines(image, scene);
+            drawarcs(image, scene, stamps);
+            stamp_hits = stamps.hits();
+            stamp_misses = stamps.misses();
+        } else {
+            TileRenderer renderer(render_threads, vm["tile"].as<int>(), stamp_budget);
+            renderer.render(scene, image);
+            stamp_hits = renderer.stamp_hits();
+            stamp_misses = renderer.stamp_misses();
+        }
     }
+    cout << "Arc stamps: " << stamp_hits << " hits, " << stamp_misses << " misses" << endl;
     
     cv::imshow("Image", image);
     // while (1) {
@@ -0,0 +1,131 @@
+#include "mapped_file.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_map_size(0)
+    {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filename, bool writable) {
+    close();
+
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    const bool ok = S_ISREG(st.st_mode) ? map(fd, size, writable) || read(fd, size)
+                                        : drain(fd);
+    ::close(fd);
+    return ok;
+}
+
+void MappedFile::close() {
+    if (m_map_size != 0) {
+        ::munmap(m_data, m_map_size);
+    }
+    m_buffer.reset();
+    m_data = nullptr;
+    m_size = 0;
+    m_map_size = 0;
+}
+
+bool MappedFile::map(int fd, std::size_t size, bool writable) {
+    if (size == 0) {
+        return false;
+    }
+
+    // Reserve room for the file plus at least one zero byte, then map the file
+    // over the front of the reservation.  Whatever is left of the last file
+    // page past EOF and any trailing anonymous page both read as zero.
+    const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t map_size = (size + 1 + page - 1) / page * page;
+    const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* base = ::mmap(nullptr, map_size, prot,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    void* file = ::mmap(base, size, prot,
+                        MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED) {
+        ::munmap(base, map_size);
+        return false;
+    }
+    ::madvise(base, size, MADV_SEQUENTIAL);
+
+    m_data = static_cast<char*>(base);
+    m_size = size;
+    m_map_size = map_size;
+    return true;
+}
+
+bool MappedFile::read(int fd, std::size_t size) {
+    m_buffer.reset(new char[size + 1]);
+    std::size_t done = 0;
+    while (done < size) {
+        const ssize_t n = ::pread(fd, m_buffer.get() + done, size - done, done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            m_buffer.reset();
+            return false;
+        }
+        if (n == 0) {
+            break; // file shrank underneath us: keep what was read
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    m_buffer[done] = 0;
+    m_data = m_buffer.get();
+    m_size = done;
+    return true;
+}
+
+bool MappedFile::drain(int fd) {
+    // The size of a pipe or procfs file says nothing about its contents, and
+    // pipes cannot be pread(): read until EOF, doubling the buffer as needed.
+    std::size_t capacity = 64 * 1024;
+    std::unique_ptr<char[]> buffer(new char[capacity + 1]);
+    std::size_t done = 0;
+    for (;;) {
+        if (done == capacity) {
+            std::unique_ptr<char[]> larger(new char[2 * capacity + 1]);
+            std::memcpy(larger.get(), buffer.get(), done);
+            buffer.swap(larger);
+            capacity *= 2;
+        }
+        const ssize_t n = ::read(fd, buffer.get() + done, capacity - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    buffer[done] = 0;
+    m_buffer.swap(buffer);
+    m_data = m_buffer.get();
+    m_size = done;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef MAPPED_FILE__H_
+#define MAPPED_FILE__H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Writable, zero-terminated view of a file's contents, suitable for handing
+// straight to rapidxml's in-place parser.
+//
+// The file is mapped MAP_PRIVATE on top of an anonymous reservation that is at
+// least one byte longer than the file, so data()[size()] is always a readable
+// zero even when the file length is an exact multiple of the page size.  Writes
+// made by the parser land in private copy-on-write pages and never reach the
+// file.  A regular file that cannot be mapped (exotic filesystems) is read
+// with pread() into a heap buffer instead; anything else (pipes, FIFOs,
+// procfs) is read to EOF, whatever size it reports.
+//
+// Opened with writable = false, the mapping is PROT_READ: no page is ever
+// copied, and a stray write faults instead of silently costing a copy.  Only
+// parsers that leave the text alone (rapidxml::parse_non_destructive, the
+// schema and indexed parsers) may be given data() then.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Returns false if the file could not be opened or read.
+    bool open(const std::string& filename, bool writable = true);
+    void close();
+
+    char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool mapped() const { return m_map_size != 0; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool map(int fd, std::size_t size, bool writable);
+    bool read(int fd, std::size_t size);
+    bool drain(int fd);
+
+    char* m_data;
+    std::size_t m_size;
+    std::size_t m_map_size; // length of the mapping, 0 if m_data is m_buffer
+    std::unique_ptr<char[]> m_buffer;
+};
+
+#endif // MAPPED_FILE__H_
@@ -0,0 +1,482 @@
+#include "plot.h"
+#include "decimal.h"
+#include "rapidxml.hpp"
+#include "rapidxml_compact.hpp"
+#include "scene.h"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <string>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool starts_with(const char* val, std::size_t size, const char* name) {
+    const std::size_t n = strlen(name);
+    return size >= n && memcmp(val, name, n) == 0;
+}
+
+} // namespace
+
+Color translate_color(const char* val, std::size_t size) {
+    if (starts_with(val, size, "yellow")) {
+        return Color::Yellow;
+    } else if (starts_with(val, size, "green")) {
+        return Color::Green;
+    } else if (starts_with(val, size, "red")) {
+        return Color::Red;
+    } else if (starts_with(val, size, "white")) {
+        return Color::White;
+    } else if (starts_with(val, size, "blue")) {
+        return Color::Blue;
+    } else {
+        assert(0); // should not get here
+        return Color::White;
+    }
+}
+
+
+std::string color_to_string(Color color) {
+    switch (color) {
+    case Color::Blue:
+        return "blue";
+    case Color::Green:
+        return "green";
+    case Color::Red:
+        return "red";
+    case Color::Yellow:
+        return "yellow";
+    case Color::White:
+    default: // not sure why g++ can't tell that there are no other exit points
+        return "white";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Line& line) {
+    os << "Line("
+       << line.x_start << ", "
+       << line.x_end << ", "
+       << line.y_start << ", "
+       << line.y_end << ", "
+       << color_to_string(line.color)
+       << ")";
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Arc& arc) {
+    os << "Arc("
+       << arc.x_center << ", "
+       << arc.y_center << ", "
+       << arc.radius << ", "
+       << arc.arc_start << ", "
+       << arc.arc_extend << ", "
+       << color_to_string(arc.color)
+       << ")";
+    return os;
+}
+
+namespace {
+
+bool is(const char* name, std::size_t size, const char* tag, std::size_t tag_size) {
+    return size == tag_size && memcmp(name, tag, size) == 0;
+}
+
+bool is_line_field(Field field) {
+    return field >= Field::XStart && field <= Field::YEnd;
+}
+
+bool is_arc_field(Field field) {
+    return field >= Field::XCenter && field <= Field::ArcExtend;
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Field values keep any whitespace around them unless trimmed by the parser.
+bool parse_number(const char* value, std::size_t size, double& number) {
+    const char* first = value;
+    const char* last = value + size;
+    while (first < last && is_space(*first)) {
+        ++first;
+    }
+    while (last > first && is_space(last[-1])) {
+        --last;
+    }
+    return parse_decimal(first, last, number);
+}
+
+void parse_field(const rapidxml::xml_node<char>* child, double& number) {
+    const auto value = child->value_ref();
+    if (!parse_number(value.data(), value.size(), number)) {
+        const auto name = child->name_ref();
+        std::cout << "Invalid number in " << std::string(name.begin(), name.end())
+                  << ": " << std::string(value.begin(), value.end()) << std::endl;
+        assert(0);
+    }
+}
+
+void parse_field(const rapidxml::xml_node<char>* child, Color& color) {
+    const auto value = child->value_ref();
+    color = translate_color(value.data(), value.size());
+}
+
+void parse_field(const rapidxml::compact_document<char>& doc, std::uint32_t child, double& number) {
+    if (!parse_number(doc.value(child), doc.value_size(child), number)) {
+        std::cout << "Invalid number in " << std::string(doc.name(child), doc.name_size(child))
+                  << ": " << std::string(doc.value(child), doc.value_size(child)) << std::endl;
+        assert(0);
+    }
+}
+
+// Whether c can follow a tag name.  Any byte below 'A' (as a signed char,
+// which is what SSE2 compares) is taken to, so "<Line1" counts as a Line:
+// counts stay upper bounds either way.
+bool ends_name(char c) {
+    return static_cast<signed char>(c) < 'A';
+}
+
+#ifdef __SSE2__
+// Sum of the 16 unsigned bytes of v.
+std::size_t lane_sum(__m128i v) {
+    const __m128i sums = _mm_sad_epu8(v, _mm_setzero_si128());
+    return static_cast<std::size_t>(_mm_cvtsi128_si32(sums)) +
+           static_cast<std::size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+}
+#endif
+
+} // namespace
+
+Element element_kind(const char* name, std::size_t size) {
+    switch (size) {
+    case 3:
+        return is(name, size, "Arc", 3) ? Element::Arc : Element::Unknown;
+    case 4:
+        return is(name, size, "Line", 4) ? Element::Line : Element::Unknown;
+    default:
+        return Element::Unknown;
+    }
+}
+
+Field field_kind(const char* name, std::size_t size) {
+    Field field = Field::Unknown;
+    const char* tag = "";
+    switch (size) {
+    case 4:
+        switch (name[0]) {
+        case 'X': field = Field::XEnd; tag = "XEnd"; break;
+        case 'Y': field = Field::YEnd; tag = "YEnd"; break;
+        }
+        break;
+    case 5:
+        field = Field::Color; tag = "Color";
+        break;
+    case 6:
+        switch (name[0]) {
+        case 'X': field = Field::XStart; tag = "XStart"; break;
+        case 'Y': field = Field::YStart; tag = "YStart"; break;
+        case 'R': field = Field::Radius; tag = "Radius"; break;
+        }
+        break;
+    case 7:
+        switch (name[0]) {
+        case 'X': field = Field::XCenter; tag = "XCenter"; break;
+        case 'Y': field = Field::YCenter; tag = "YCenter"; break;
+        }
+        break;
+    case 8:
+        field = Field::ArcStart; tag = "ArcStart";
+        break;
+    case 9:
+        field = Field::ArcExtend; tag = "ArcExtend";
+        break;
+    }
+    return field != Field::Unknown && memcmp(name, tag, size) == 0 ? field : Field::Unknown;
+}
+
+PlotCounts count_plot(const char* text, std::size_t size) {
+    PlotCounts counts;
+    const char* p = text;
+    const char* const end = text + size;
+#ifdef __SSE2__
+    // 16 positions at a time, with no branch per tag: each position is
+    // compared against '<' and the five bytes after it are read through
+    // shifted loads.  Hits
+    // are summed per byte lane (a true compare is -1) and the lanes are
+    // folded into the totals before they can wrap.
+    const __m128i alpha = _mm_set1_epi8('A');
+    while (end - p >= 16 + 5) {
+        __m128i elements = _mm_setzero_si128();
+        __m128i lines = _mm_setzero_si128();
+        __m128i arcs = _mm_setzero_si128();
+        for (int n = 0; n < 255 && end - p >= 16 + 5; ++n, p += 16) {
+            const __m128i v[6] = {
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 3)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 5))
+            };
+            const __m128i open = _mm_cmpeq_epi8(v[0], _mm_set1_epi8('<'));
+            const __m128i other = _mm_or_si128(
+                _mm_cmpeq_epi8(v[1], _mm_set1_epi8('/')),
+                _mm_or_si128(_mm_cmpeq_epi8(v[1], _mm_set1_epi8('!')),
+                             _mm_cmpeq_epi8(v[1], _mm_set1_epi8('?'))));
+            const __m128i start = _mm_andnot_si128(other, open);
+            const __m128i line = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(v[1], _mm_set1_epi8('L')),
+                              _mm_cmpeq_epi8(v[2], _mm_set1_epi8('i'))),
+                _mm_and_si128(_mm_cmpeq_epi8(v[3], _mm_set1_epi8('n')),
+                              _mm_and_si128(_mm_cmpeq_epi8(v[4], _mm_set1_epi8('e')),
+                                            _mm_cmplt_epi8(v[5], alpha))));
+            const __m128i arc = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi8(v[1], _mm_set1_epi8('A')),
+                              _mm_cmpeq_epi8(v[2], _mm_set1_epi8('r'))),
+                _mm_and_si128(_mm_cmpeq_epi8(v[3], _mm_set1_epi8('c')),
+                              _mm_cmplt_epi8(v[4], alpha)));
+            elements = _mm_sub_epi8(elements, start);
+            lines = _mm_sub_epi8(lines, _mm_and_si128(start, line));
+            arcs = _mm_sub_epi8(arcs, _mm_and_si128(start, arc));
+        }
+        counts.elements += lane_sum(elements);
+        counts.lines += lane_sum(lines);
+        counts.arcs += lane_sum(arcs);
+    }
+#endif
+    while ((p = static_cast<const char*>(memchr(p, '<', end - p)))) {
+        if (++p == end) {
+            break;
+        }
+        if (*p == '/' || *p == '!' || *p == '?') {
+            continue;
+        }
+        ++counts.elements;
+        // Only "Line" and "Arc" can match, followed by the end of the name.
+        const std::size_t n = *p == 'L' ? 4 : 3;
+        if (static_cast<std::size_t>(end - p) <= n || !ends_name(p[n])) {
+            continue;
+        }
+        switch (element_kind(p, n)) {
+        case Element::Line:
+            ++counts.lines;
+            break;
+        case Element::Arc:
+            ++counts.arcs;
+            break;
+        default:
+            break;
+        }
+    }
+    return counts;
+}
+
+Line parse_line(const rapidxml::xml_node<char>* node) {
+    using namespace std;
+    namespace xml = rapidxml;
+    Line line;
+    for (xml::xml_node<> *child = node->first_node(); child; child = child->next_sibling()) {
+        const auto name = child->name_ref();
+        switch (field_kind(name.data(), name.size())) {
+        case Field::XStart:
+            parse_field(child, line.x_start);
+            break;
+        case Field::XEnd:
+            parse_field(child, line.x_end);
+            break;
+        case Field::YStart:
+            parse_field(child, line.y_start);
+            break;
+        case Field::YEnd:
+            parse_field(child, line.y_end);
+            break;
+        case Field::Color:
+            parse_field(child, line.color);
+            break;
+        default:
+            cout << "Unknown line child: " << string(name.begin(), name.end()) << endl;
+            assert(0);
+        }
+    }
+    return line;
+}
+
+Arc parse_arc(const rapidxml::xml_node<char>* node) {
+    using namespace std;
+    namespace xml = rapidxml;
+    Arc arc;
+    for (xml::xml_node<> *child = node->first_node(); child; child = child->next_sibling()) {
+        const auto name = child->name_ref();
+        switch (field_kind(name.data(), name.size())) {
+        case Field::XCenter:
+            parse_field(child, arc.x_center);
+            break;
+        case Field::YCenter:
+            parse_field(child, arc.y_center);
+            break;
+        case Field::Radius:
+            parse_field(child, arc.radius);
+            break;
+        case Field::ArcStart:
+            parse_field(child, arc.arc_start);
+            break;
+        case Field::ArcExtend:
+            parse_field(child, arc.arc_extend);
+            break;
+        case Field::Color:
+            parse_field(child, arc.color);
+            break;
+        default:
+            cout << "Unknown arc child: " << string(name.begin(), name.end()) << endl;
+            assert(0);
+        }
+    }
+    return arc;
+}
+
+Line parse_line(const rapidxml::compact_document<char>& doc, std::uint32_t node) {
+    using namespace std;
+    Line line;
+    for (auto child = doc.first_node(node); child != doc.npos; child = doc.next_sibling(child)) {
+        switch (field_kind(doc.name(child), doc.name_size(child))) {
+        case Field::XStart:
+            parse_field(doc, child, line.x_start);
+            break;
+        case Field::XEnd:
+            parse_field(doc, child, line.x_end);
+            break;
+        case Field::YStart:
+            parse_field(doc, child, line.y_start);
+            break;
+        case Field::YEnd:
+            parse_field(doc, child, line.y_end);
+            break;
+        case Field::Color:
+            line.color = translate_color(doc.value(child), doc.value_size(child));
+            break;
+        default:
+            cout << "Unknown line child: " << string(doc.name(child), doc.name_size(child)) << endl;
+            assert(0);
+        }
+    }
+    return line;
+}
+
+Arc parse_arc(const rapidxml::compact_document<char>& doc, std::uint32_t node) {
+    using namespace std;
+    Arc arc;
+    for (auto child = doc.first_node(node); child != doc.npos; child = doc.next_sibling(child)) {
+        switch (field_kind(doc.name(child), doc.name_size(child))) {
+        case Field::XCenter:
+            parse_field(doc, child, arc.x_center);
+            break;
+        case Field::YCenter:
+            parse_field(doc, child, arc.y_center);
+            break;
+        case Field::Radius:
+            parse_field(doc, child, arc.radius);
+            break;
+        case Field::ArcStart:
+            parse_field(doc, child, arc.arc_start);
+            break;
+        case Field::ArcExtend:
+            parse_field(doc, child, arc.arc_extend);
+            break;
+        case Field::Color:
+            arc.color = translate_color(doc.value(child), doc.value_size(child));
+            break;
+        default:
+            cout << "Unknown arc child: " << string(doc.name(child), doc.name_size(child)) << endl;
+            assert(0);
+        }
+    }
+    return arc;
+}
+
+PlotBuilder::PlotBuilder(Scene& scene)
+    : m_scene(scene)
+    , m_depth(0)
+    , m_in_line(false)
+    , m_field(Field::Unknown)
+    {}
+
+void PlotBuilder::start_element(char* name, std::size_t size) {
+    namespace xml = rapidxml;
+    switch (++m_depth) {
+    case 1: // root
+        break;
+    case 2:
+        switch (element_kind(name, size)) {
+        case Element::Line:
+            m_line = Line();
+            m_in_line = true;
+            break;
+        case Element::Arc:
+            m_arc = Arc();
+            m_in_line = false;
+            break;
+        default:
+            throw xml::parse_error("unknown element", name);
+        }
+        break;
+    case 3:
+        m_field = field_kind(name, size);
+        if (m_field != Field::Color &&
+            !(m_in_line ? is_line_field(m_field) : is_arc_field(m_field))) {
+            throw xml::parse_error(m_in_line ? "unknown line child" : "unknown arc child", name);
+        }
+        break;
+    default:
+        throw xml::parse_error("unexpected nested element", name);
+    }
+}
+
+void PlotBuilder::text(char* value, std::size_t size) {
+    if (m_field == Field::Unknown) {
+        return;
+    }
+    if (m_field == Field::Color) {
+        const Color color = translate_color(value, size);
+        if (m_in_line) {
+            m_line.color = color;
+        } else {
+            m_arc.color = color;
+        }
+        return;
+    }
+
+    double val;
+    if (!parse_number(value, size, val)) {
+        throw rapidxml::parse_error("invalid number", value);
+    }
+    switch (m_field) {
+    case Field::XStart:    m_line.x_start = val; break;
+    case Field::XEnd:      m_line.x_end = val; break;
+    case Field::YStart:    m_line.y_start = val; break;
+    case Field::YEnd:      m_line.y_end = val; break;
+    case Field::XCenter:   m_arc.x_center = val; break;
+    case Field::YCenter:   m_arc.y_center = val; break;
+    case Field::Radius:    m_arc.radius = val; break;
+    case Field::ArcStart:  m_arc.arc_start = val; break;
+    case Field::ArcExtend: m_arc.arc_extend = val; break;
+    default:
+        break;
+    }
+}
+
+void PlotBuilder::end_element(char*, std::size_t) {
+    switch (m_depth--) {
+    case 2:
+        if (m_in_line) {
+            m_scene.add(m_line);
+        } else {
+            m_scene.add(m_arc);
+        }
+        break;
+    case 3:
+        m_field = Field::Unknown;
+        break;
+    }
+}
@@ -0,0 +1,148 @@
+#ifndef PLOT__H_
+#define PLOT__H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace rapidxml {
+    template<class Ch> class xml_node;
+    template<class Ch> class compact_document;
+}
+
+class Scene;
+
+// One byte, so that a Scene spends a single byte per primitive on it.
+enum class Color : std::uint8_t {
+    Blue,
+    Green,
+    Red,
+    Yellow,
+    White
+};
+
+// Classify a color value by its leading name; val need not be zero terminated.
+Color translate_color(const char* val, std::size_t size);
+std::string color_to_string(Color color);
+
+struct Line {
+    Line()
+        : x_start(0.0)
+        , x_end(0.0)
+        , y_start(0.0)
+        , y_end(0.0)
+        , color(Color::White)
+        {}
+
+    Line(double x1, double x2, double y1, double y2, Color c=Color::White)
+        : x_start(x1)
+        , x_end(x2)
+        , y_start(y1)
+        , y_end(y2)
+        , color(c)
+        {}
+
+    double x_start;
+    double x_end;
+    double y_start;
+    double y_end;
+    Color color;
+};
+std::ostream& operator<<(std::ostream& os, const Line& line);
+
+struct Arc {
+    Arc()
+        : x_center(0.0)
+        , y_center(0.0)
+        , radius(0.0)
+        , arc_start(0.0)
+        , arc_extend(0.0)
+        , color(Color::White)
+        {}
+
+    Arc(double x, double y, double r, double s, double e, Color c=Color::White)
+        : x_center(x)
+        , y_center(y)
+        , radius(r)
+        , arc_start(s)
+        , arc_extend(e)
+        , color(c)
+        {}
+
+    double x_center;
+    double y_center;
+    double radius;
+    double arc_start;
+    double arc_extend;
+    Color color;
+};
+std::ostream& operator<<(std::ostream& os, const Arc& arc);
+
+// Children of the root element, and fields of <Line>/<Arc>.
+enum class Element {
+    Unknown,
+    Line,
+    Arc
+};
+
+enum class Field {
+    Unknown,
+    XStart, XEnd, YStart, YEnd,
+    XCenter, YCenter, Radius, ArcStart, ArcExtend,
+    Color
+};
+
+// Classify a tag by its name; name need not be zero terminated.  Both
+// dispatch on length and first character and confirm with one memcmp, so
+// they never allocate.
+Element element_kind(const char* name, std::size_t size);
+Field field_kind(const char* name, std::size_t size);
+
+// Upper bounds on the contents of a ppcPlot document, found by a single SSE2
+// pass (memchr() without it): start tags named Line and Arc, and start tags
+// of any name.  Tags inside comments and CDATA sections are counted as well,
+// so a count can be high but is never low.  Used to size storage before a
+// parse, so that it never grows during one.
+struct PlotCounts {
+    PlotCounts()
+        : lines(0)
+        , arcs(0)
+        , elements(0)
+        {}
+
+    std::size_t lines;
+    std::size_t arcs;
+    std::size_t elements;
+};
+PlotCounts count_plot(const char* text, std::size_t size);
+
+// Build a primitive from a parsed <Line> or <Arc> element.
+Line parse_line(const rapidxml::xml_node<char>* node);
+Arc parse_arc(const rapidxml::xml_node<char>* node);
+Line parse_line(const rapidxml::compact_document<char>& doc, std::uint32_t node);
+Arc parse_arc(const rapidxml::compact_document<char>& doc, std::uint32_t node);
+
+// Event handler for xml_document<>::parse_sax() that fills a Scene in a
+// single pass, without a DOM.  Throws rapidxml::parse_error on elements that
+// are not part of the ppcPlot grammar.
+class PlotBuilder {
+public:
+    explicit PlotBuilder(Scene& scene);
+
+    void start_element(char* name, std::size_t size);
+    void attribute(char*, std::size_t, char*, std::size_t) {}
+    void text(char* value, std::size_t size);
+    void end_element(char* name, std::size_t size);
+
+private:
+    Scene& m_scene;
+    Line m_line;        // element being read, added to m_scene when it ends
+    Arc m_arc;
+    int m_depth;
+    bool m_in_line;
+    Field m_field;
+};
+
+#endif // PLOT__H_
@@ -0,0 +1,404 @@
+#include "plot_archive.h"
+#include "mapped_file.h"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'P', 'P', 'C', 'P', 'A', 'C', 'K', '\0'};
+const std::uint64_t VERSION = 1;
+const int MAX_SCALE = 1000000;
+
+// Largest scaled magnitude: below 2^53, so every such integer is a double.
+const double MAX_SCALED = 1e15;
+
+enum Kind {
+    LINES = 0,
+    ARCS = 1
+};
+
+void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+std::uint64_t zigzag(std::uint64_t value) {
+    return (value << 1) ^ (0 - (value >> 63));
+}
+
+std::uint64_t unzigzag(std::uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+std::int64_t scaled(std::int16_t value, double) {
+    return value;
+}
+
+std::int64_t scaled(double value, double scale) {
+    return std::llrint(value * scale);
+}
+
+bool exact(const std::vector<double>& column, double scale) {
+    for (const double value : column) {
+        const double v = value * scale;
+        if (!(std::fabs(v) <= MAX_SCALED) || std::llrint(v) / scale != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Smallest power of ten that scales every value of a double scene to an
+// integer, or 0.
+int find_scale(const Scene::Lines& lines, const Scene::Arcs& arcs) {
+    for (int scale = 1; scale <= MAX_SCALE; scale *= 10) {
+        if (exact(lines.x_start, scale) && exact(lines.x_end, scale) &&
+            exact(lines.y_start, scale) && exact(lines.y_end, scale) &&
+            exact(arcs.x_center, scale) && exact(arcs.y_center, scale) &&
+            exact(arcs.radius, scale) && exact(arcs.arc_start, scale) &&
+            exact(arcs.arc_extend, scale)) {
+            return scale;
+        }
+    }
+    return 0;
+}
+
+template<typename T>
+void put_column(std::string& out, const std::vector<T>& column,
+                std::size_t begin, std::size_t end, double scale) {
+    std::int64_t previous = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+        const std::int64_t value = scaled(column[i], scale);
+        put_varint(out, zigzag(static_cast<std::uint64_t>(value) -
+                               static_cast<std::uint64_t>(previous)));
+        previous = value;
+    }
+}
+
+void put_colors(std::string& out, const std::vector<Color>& colors,
+                std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ) {
+        std::size_t run = 1;
+        while (i + run < end && colors[i + run] == colors[i]) {
+            ++run;
+        }
+        put_varint(out, (run - 1) * 8 + static_cast<std::uint64_t>(colors[i]));
+        i += run;
+    }
+}
+
+// Encodes the blocks of one kind into payload, and their entries into
+// directory.
+template<typename T>
+std::size_t put_blocks(std::string& directory, std::string& payload,
+                       const LineColumns<T>& lines, double scale) {
+    std::size_t blocks = 0;
+    for (std::size_t begin = 0; begin < lines.color.size(); begin += PlotArchive::BLOCK_SIZE) {
+        const std::size_t end = std::min(lines.color.size(), begin + PlotArchive::BLOCK_SIZE);
+        const std::size_t start = payload.size();
+        put_column(payload, lines.x_start, begin, end, scale);
+        put_column(payload, lines.x_end, begin, end, scale);
+        put_column(payload, lines.y_start, begin, end, scale);
+        put_column(payload, lines.y_end, begin, end, scale);
+        put_colors(payload, lines.color, begin, end);
+        put_varint(directory, LINES);
+        put_varint(directory, end - begin);
+        put_varint(directory, payload.size() - start);
+        ++blocks;
+    }
+    return blocks;
+}
+
+template<typename T>
+std::size_t put_blocks(std::string& directory, std::string& payload,
+                       const ArcColumns<T>& arcs, double scale) {
+    std::size_t blocks = 0;
+    for (std::size_t begin = 0; begin < arcs.color.size(); begin += PlotArchive::BLOCK_SIZE) {
+        const std::size_t end = std::min(arcs.color.size(), begin + PlotArchive::BLOCK_SIZE);
+        const std::size_t start = payload.size();
+        put_column(payload, arcs.x_center, begin, end, scale);
+        put_column(payload, arcs.y_center, begin, end, scale);
+        put_column(payload, arcs.radius, begin, end, scale);
+        put_column(payload, arcs.arc_start, begin, end, scale);
+        put_column(payload, arcs.arc_extend, begin, end, scale);
+        put_colors(payload, arcs.color, begin, end);
+        put_varint(directory, ARCS);
+        put_varint(directory, end - begin);
+        put_varint(directory, payload.size() - start);
+        ++blocks;
+    }
+    return blocks;
+}
+
+// Bounds-checked varint reader; ok() turns false on any overrun.
+class Input {
+public:
+    Input(const char* first, const char* last)
+        : m_pos(reinterpret_cast<const unsigned char*>(first))
+        , m_end(reinterpret_cast<const unsigned char*>(last))
+        , m_ok(true)
+        {}
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (m_pos == m_end) {
+                break;
+            }
+            const unsigned char byte = *m_pos++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) {
+                return value;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    // Reads count delta-encoded values, scaled back to doubles.
+    void column(std::vector<double>& values, std::size_t count, double scale) {
+        values.resize(count);
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            value += unzigzag(varint());
+            values[i] = static_cast<std::int64_t>(value) / scale;
+        }
+    }
+
+    void colors(std::vector<Color>& colors, std::size_t count) {
+        colors.clear();
+        while (m_ok && colors.size() < count) {
+            const std::uint64_t run = varint();
+            const std::uint64_t color = run % 8;
+            if (color > static_cast<std::uint64_t>(Color::White) ||
+                run / 8 >= count - colors.size()) {
+                m_ok = false;
+                break;
+            }
+            colors.insert(colors.end(), run / 8 + 1, static_cast<Color>(color));
+        }
+    }
+
+    bool ok() const { return m_ok; }
+    bool done() const { return m_pos == m_end; }
+    const char* pos() const { return reinterpret_cast<const char*>(m_pos); }
+
+private:
+    const unsigned char* m_pos;
+    const unsigned char* m_end;
+    bool m_ok;
+};
+
+struct Block {
+    std::uint64_t kind;
+    std::size_t count;
+    const char* first;
+    const char* last;
+};
+
+bool decode(const Block& block, double scale, Scene& scene) {
+    Input in(block.first, block.last);
+    std::vector<double> a, b, c, d, e;
+    std::vector<Color> colors;
+    if (block.kind == LINES) {
+        in.column(a, block.count, scale);
+        in.column(b, block.count, scale);
+        in.column(c, block.count, scale);
+        in.column(d, block.count, scale);
+        in.colors(colors, block.count);
+        if (!in.ok() || !in.done()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < block.count; ++i) {
+            scene.add(Line(a[i], b[i], c[i], d[i], colors[i]));
+        }
+    } else {
+        in.column(a, block.count, scale);
+        in.column(b, block.count, scale);
+        in.column(c, block.count, scale);
+        in.column(d, block.count, scale);
+        in.column(e, block.count, scale);
+        in.colors(colors, block.count);
+        if (!in.ok() || !in.done()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < block.count; ++i) {
+            scene.add(Arc(a[i], b[i], c[i], d[i], e[i], colors[i]));
+        }
+    }
+    return true;
+}
+
+// A run of consecutive blocks decoded by one thread.
+struct Part {
+    Part(const Block* first, const Block* last, int scale)
+        : first(first)
+        , last(last)
+        , scene(scale ? Scene(scale) : Scene())
+        , ok(false)
+        {}
+
+    const Block* first;
+    const Block* last;
+    Scene scene;
+    bool ok;
+};
+
+void decode_part(Part& part, double scale) {
+    part.ok = true;
+    for (const Block* block = part.first; part.ok && block != part.last; ++block) {
+        part.ok = decode(*block, scale, part.scene);
+    }
+}
+
+} // namespace
+
+const std::size_t PlotArchive::BLOCK_SIZE;
+
+bool PlotArchive::write(const std::string& filename, const Scene& scene) {
+    const int scale = scene.fixed() ? scene.scale() : find_scale(scene.lines(), scene.arcs());
+    if (scale == 0) {
+        return fail("Values need more than 6 decimals or are too large: " + filename);
+    }
+
+    std::string directory;
+    std::string payload;
+    std::size_t blocks;
+    if (scene.fixed()) {
+        blocks = put_blocks(directory, payload, scene.fixed_lines(), scale);
+        blocks += put_blocks(directory, payload, scene.fixed_arcs(), scale);
+    } else {
+        blocks = put_blocks(directory, payload, scene.lines(), scale);
+        blocks += put_blocks(directory, payload, scene.arcs(), scale);
+    }
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    put_varint(header, VERSION);
+    put_varint(header, scale);
+    put_varint(header, scene.line_count());
+    put_varint(header, scene.arc_count());
+    put_varint(header, blocks);
+
+    // Written beside the target and renamed over it, so a failed write never
+    // leaves a truncated archive behind.
+    const std::string temp = filename + "." + std::to_string(::getpid()) + ".tmp";
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(header.data(), header.size());
+    out.write(directory.data(), directory.size());
+    out.write(payload.data(), payload.size());
+    out.close();
+    if (!out || std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return fail("Unable to write: " + filename);
+    }
+    return true;
+}
+
+bool PlotArchive::read(const std::string& filename, unsigned threads, Scene& scene) {
+    MappedFile file;
+    if (!file.open(filename, false)) {
+        return fail("Unable to open: " + filename);
+    }
+    if (file.size() < sizeof(MAGIC) || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("Not a plot archive: " + filename);
+    }
+
+    Input in(file.data() + sizeof(MAGIC), file.data() + file.size());
+    const std::uint64_t version = in.varint();
+    const std::uint64_t scale = in.varint();
+    const std::uint64_t counts[2] = {in.varint(), in.varint()};
+    const std::uint64_t block_count = in.varint();
+    if (!in.ok() || version != VERSION) {
+        return fail("Unsupported plot archive: " + filename);
+    }
+    // Every directory entry takes at least three bytes, which bounds the
+    // count from the file before anything is sized by it.
+    const std::size_t rest = static_cast<std::size_t>(file.data() + file.size() - in.pos());
+    if (scale == 0 || scale > 0x7fffffff || block_count > rest / 3) {
+        return fail("Corrupt plot archive header: " + filename);
+    }
+
+    std::vector<Block> blocks(block_count);
+    std::vector<std::uint64_t> offsets(block_count + 1);
+    std::uint64_t totals[2] = {0, 0};
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].kind = in.varint();
+        blocks[i].count = in.varint();
+        const std::uint64_t size = in.varint();
+        if (!in.ok() || blocks[i].kind > ARCS || blocks[i].count > BLOCK_SIZE ||
+            size > file.size()) {
+            return fail("Corrupt plot archive directory: " + filename);
+        }
+        totals[blocks[i].kind] += blocks[i].count;
+        offsets[i + 1] = offsets[i] + size;
+    }
+    const char* const base = in.pos();
+    if (totals[LINES] != counts[LINES] || totals[ARCS] != counts[ARCS] ||
+        offsets.back() != static_cast<std::uint64_t>(file.data() + file.size() - base)) {
+        return fail("Corrupt plot archive directory: " + filename);
+    }
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+        blocks[i].first = base + offsets[i];
+        blocks[i].last = base + offsets[i + 1];
+    }
+
+    // Even runs of blocks, one per thread; the first on this one.
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const std::size_t count = std::max<std::size_t>(1, std::min<std::size_t>(threads, blocks.size()));
+    std::vector<Part> parts;
+    parts.reserve(count);
+    for (std::size_t k = 0; k < count; ++k) {
+        parts.push_back(Part(blocks.data() + blocks.size() * k / count,
+                             blocks.data() + blocks.size() * (k + 1) / count,
+                             scene.scale()));
+    }
+    const double divisor = static_cast<double>(scale);
+    std::vector<std::thread> workers;
+    for (std::size_t k = 1; k < parts.size(); ++k) {
+        workers.push_back(std::thread(decode_part, std::ref(parts[k]), divisor));
+    }
+    decode_part(parts[0], divisor);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const Part& part : parts) {
+        if (!part.ok) {
+            return fail("Corrupt plot archive block: " + filename);
+        }
+    }
+    scene.reserve(scene.line_count() + counts[LINES], scene.arc_count() + counts[ARCS]);
+    for (const Part& part : parts) {
+        scene.append(part.scene);
+    }
+    return true;
+}
+
+bool PlotArchive::is_archive(const std::string& filename) {
+    // Peeking at a pipe would consume what the parser needs.
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    std::ifstream in(filename, std::ios::binary);
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool PlotArchive::fail(const std::string& what) {
+    m_error = what;
+    return false;
+}
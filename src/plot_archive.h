@@ -0,0 +1,58 @@
+#ifndef PLOT_ARCHIVE__H_
+#define PLOT_ARCHIVE__H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Scene;
+
+// Compact, portable file format for the primitives of a plot, typically a
+// tenth of the size of the ppcPlot XML or less.
+//
+// Every value is stored as the integer value * scale, where scale is the
+// smallest power of ten (up to 10^6) that represents all of them exactly, or
+// the scale of a fixed-point Scene.  Lines and arcs are cut into blocks of up
+// to BLOCK_SIZE primitives.  Within a block each column is stored as the
+// difference of every value from the previous one (from 0 for the first),
+// zigzag-encoded so small negative steps stay small, as a LEB128 varint.
+// Colors follow as runs: one varint (run length - 1) * 8 + color per run.
+// No block refers to another, so blocks decode independently.
+//
+// Layout (all integers are unsigned varints, so the format has no byte
+// order):
+//
+//     magic "PPCPACK\0"
+//     version, scale, line count, arc count, block count
+//     per block: kind (0 lines, 1 arcs), primitives, payload bytes
+//     payloads, in block order: lines first, then arcs
+//
+// Line columns are x_start, x_end, y_start, y_end and arc columns x_center,
+// y_center, radius, arc_start, arc_extend, each followed by the colors.
+class PlotArchive {
+public:
+    static const std::size_t BLOCK_SIZE = 4096;
+
+    // Writes scene to filename, replacing it only once the whole archive is
+    // written.  Fails if some value is not a multiple of 10^-6, or is too
+    // large to scale.
+    bool write(const std::string& filename, const Scene& scene);
+
+    // Appends the primitives stored in filename to scene, decoding blocks on
+    // up to `threads` threads (0 means one per hardware thread).  On failure
+    // scene is unchanged.
+    bool read(const std::string& filename, unsigned threads, Scene& scene);
+
+    // Whether filename is a regular file starting with the archive magic.
+    static bool is_archive(const std::string& filename);
+
+    // What went wrong in the last failed write() or read().
+    const std::string& error() const { return m_error; }
+
+private:
+    bool fail(const std::string& what);
+
+    std::string m_error;
+};
+
+#endif // PLOT_ARCHIVE__H_
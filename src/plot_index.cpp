@@ -0,0 +1,347 @@
+#include "plot_index.h"
+#include "decimal.h"
+#include "rapidxml.hpp"
+#include <cstring>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+[[noreturn]] void error(const char* what, const char* where) {
+    throw rapidxml::parse_error(what, const_cast<char*>(where));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stage one: structural bitmaps
+
+const std::size_t BLOCK = 64;
+
+// Bit i is set if block[i] is '<', '>', '"' or '\''.
+std::uint64_t structural_mask(const char* block) {
+#ifdef __SSE2__
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i dq = _mm_set1_epi8('"');
+    const __m128i sq = _mm_set1_epi8('\'');
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < BLOCK; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, dq), _mm_cmpeq_epi8(v, sq)));
+        mask |= std::uint64_t(static_cast<unsigned>(_mm_movemask_epi8(hit))) << i;
+    }
+    return mask;
+#else
+    std::uint64_t mask = 0;
+    for (std::size_t i = 0; i < BLOCK; ++i) {
+        const char c = block[i];
+        mask |= std::uint64_t(c == '<' || c == '>' || c == '"' || c == '\'') << i;
+    }
+    return mask;
+#endif
+}
+
+// Calls f(mask, base) with the structural_mask() of each block of text,
+// base being the offset of the block.  The last block is padded with zeros.
+template<typename F>
+void each_block(const char* text, std::size_t size, F f) {
+    std::size_t i = 0;
+    for (; i + BLOCK <= size; i += BLOCK) {
+        f(structural_mask(text + i), i);
+    }
+    if (i < size) {
+        char tail[BLOCK] = {};
+        memcpy(tail, text + i, size - i);
+        f(structural_mask(tail), i);
+    }
+}
+
+// Writes base plus the position of each set bit to out, which must have room
+// for them; returns the end of what was written.
+std::uint32_t* append(std::uint32_t* out, std::uint64_t mask, std::size_t base) {
+    while (mask) {
+        *out++ = static_cast<std::uint32_t>(base + __builtin_ctzll(mask));
+        mask &= mask - 1;
+    }
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stage two: walking the offsets
+
+struct Walker {
+    const char* text;
+    const char* end;
+    const std::uint32_t* pos;  // next unconsumed offset
+    const std::uint32_t* last;
+
+    char at(const std::uint32_t* p) const { return text[*p]; }
+};
+
+enum class Kind {
+    Start,
+    End,
+    Empty
+};
+
+struct Tag {
+    Kind kind;
+    const char* name;
+    std::size_t size;
+    const char* close; // the '>' ending the tag
+};
+
+bool starts_with(const char* p, const char* end, const char* prefix) {
+    const std::size_t n = strlen(prefix);
+    return static_cast<std::size_t>(end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Consumes offsets up to and including the next '<'; returns it, or nullptr
+// if there is none.  Quotes and '>' in character data are passed over.
+const char* next_open(Walker& w) {
+    while (w.pos != w.last && w.at(w.pos) != '<') {
+        ++w.pos;
+    }
+    return w.pos == w.last ? nullptr : w.text + *w.pos++;
+}
+
+// Consumes offsets up to and including the '>' that ends the current tag,
+// stepping over quoted attribute values.
+const char* close_tag(Walker& w) {
+    for (;;) {
+        if (w.pos == w.last) {
+            error("unexpected end of data", w.end);
+        }
+        const char c = w.at(w.pos);
+        if (c == '>') {
+            return w.text + *w.pos++;
+        }
+        if (c == '<') {
+            error("unexpected <", w.text + *w.pos);
+        }
+        const std::uint32_t* quote = w.pos + 1;
+        while (quote != w.last && w.at(quote) != c) {
+            ++quote;
+        }
+        if (quote == w.last) {
+            error("expected ' or \"", w.end);
+        }
+        w.pos = quote + 1;
+    }
+}
+
+// Consumes offsets up to and including the first '>' at or after from that
+// is preceded by suffix, e.g. "--" for a comment.
+void skip_markup(Walker& w, const char* from, const char* suffix) {
+    const std::size_t n = strlen(suffix);
+    for (;;) {
+        while (w.pos != w.last && w.at(w.pos) != '>') {
+            ++w.pos;
+        }
+        if (w.pos == w.last) {
+            error("unexpected end of data", w.end);
+        }
+        const char* gt = w.text + *w.pos++;
+        if (static_cast<std::size_t>(gt - from) >= n && memcmp(gt - n, suffix, n) == 0) {
+            return;
+        }
+    }
+}
+
+// Skips the comment, CDATA section, processing instruction or doctype whose
+// '<' is just before p.
+void skip_special(Walker& w, const char* p) {
+    if (starts_with(p, w.end, "!--")) {
+        skip_markup(w, p + 3, "--");
+    } else if (starts_with(p, w.end, "![CDATA[")) {
+        skip_markup(w, p + 8, "]]");
+    } else if (*p == '?') {
+        skip_markup(w, p + 1, "?");
+    } else {
+        close_tag(w);
+    }
+}
+
+// Reads the markup opened by the '<' at open.  Returns false, having skipped
+// it, if it is not an element tag.
+bool read_tag(Walker& w, const char* open, Tag& tag) {
+    const char* p = open + 1;
+    if (p < w.end && (*p == '!' || *p == '?')) {
+        skip_special(w, p);
+        return false;
+    }
+
+    tag.close = close_tag(w);
+    if (*p == '/') {
+        tag.kind = Kind::End;
+        ++p;
+    } else {
+        tag.kind = tag.close[-1] == '/' ? Kind::Empty : Kind::Start;
+    }
+    tag.name = p;
+    while (p < tag.close && !is_space(*p) && *p != '/') {
+        ++p;
+    }
+    tag.size = p - tag.name;
+    return true;
+}
+
+// Reads the next element tag; returns false at the end of the data.
+bool next_tag(Walker& w, Tag& tag) {
+    for (;;) {
+        const char* open = next_open(w);
+        if (!open) {
+            return false;
+        }
+        if (read_tag(w, open, tag)) {
+            return true;
+        }
+    }
+}
+
+double* number(Line& line, Field field) {
+    switch (field) {
+    case Field::XStart: return &line.x_start;
+    case Field::XEnd:   return &line.x_end;
+    case Field::YStart: return &line.y_start;
+    case Field::YEnd:   return &line.y_end;
+    default:            return nullptr;
+    }
+}
+
+double* number(Arc& arc, Field field) {
+    switch (field) {
+    case Field::XCenter:   return &arc.x_center;
+    case Field::YCenter:   return &arc.y_center;
+    case Field::Radius:    return &arc.radius;
+    case Field::ArcStart:  return &arc.arc_start;
+    case Field::ArcExtend: return &arc.arc_extend;
+    default:               return nullptr;
+    }
+}
+
+// Parses the fields of a <Line> or <Arc> whose start tag has been read, up to
+// and including its closing tag.
+template<class T>
+void parse_fields(Walker& w, T& out) {
+    Tag tag;
+    for (;;) {
+        if (!next_tag(w, tag)) {
+            error("unexpected end of data", w.end);
+        }
+        if (tag.kind == Kind::End) {
+            return;
+        }
+        const Field field = field_kind(tag.name, tag.size);
+        double* const target = number(out, field);
+        if (!target && field != Field::Color) {
+            error("unknown field", tag.name);
+        }
+        if (tag.kind == Kind::Empty) {
+            continue; // <Field/> leaves the default value
+        }
+
+        const char* value = tag.close + 1;
+        const char* value_end = next_open(w);
+        if (!value_end) {
+            error("unexpected end of data", w.end);
+        }
+        if (!read_tag(w, value_end, tag) || tag.kind != Kind::End) {
+            error("expected closing tag", value_end);
+        }
+        if (!target) {
+            out.color = translate_color(value, value_end - value);
+            continue;
+        }
+        while (value < value_end && is_space(*value)) {
+            ++value;
+        }
+        while (value_end > value && is_space(value_end[-1])) {
+            --value_end;
+        }
+        if (!parse_decimal(value, value_end, *target)) {
+            error("invalid number", value);
+        }
+    }
+}
+
+} // namespace
+
+StructuralIndex::StructuralIndex()
+    : m_size(0)
+    , m_capacity(0)
+    {}
+
+void StructuralIndex::build(const char* text, std::size_t size) {
+    if (size > std::numeric_limits<std::uint32_t>::max()) {
+        error("document too large to index", text);
+    }
+    std::size_t count = 0;
+    each_block(text, size, [&](std::uint64_t mask, std::size_t) {
+        count += __builtin_popcountll(mask);
+    });
+    if (m_capacity < count) {
+        m_offsets.reset(new std::uint32_t[count]);
+        m_capacity = count;
+    }
+
+    std::uint32_t* out = m_offsets.get();
+    each_block(text, size, [&](std::uint64_t mask, std::size_t base) {
+        out = append(out, mask, base);
+    });
+    m_size = out - m_offsets.get();
+}
+
+void parse_plot_indexed(const char* text, std::size_t size, Scene& scene) {
+    StructuralIndex index;
+    index.build(text, size);
+
+    Walker w = { text, text + size, index.begin(), index.end() };
+
+    Tag tag;
+    if (!next_tag(w, tag)) {
+        error("no root element", w.end);
+    }
+    if (tag.kind == Kind::End) {
+        error("unexpected closing tag", tag.name);
+    }
+    if (tag.kind == Kind::Empty) {
+        return; // <ppcPlot/>
+    }
+
+    for (;;) {
+        if (!next_tag(w, tag)) {
+            error("unexpected end of data", w.end);
+        }
+        if (tag.kind == Kind::End) {
+            return; // </ppcPlot>; anything after it is ignored
+        }
+        switch (element_kind(tag.name, tag.size)) {
+        case Element::Line: {
+            Line line;
+            if (tag.kind == Kind::Start) {
+                parse_fields(w, line);
+            }
+            scene.add(line);
+            break;
+        }
+        case Element::Arc: {
+            Arc arc;
+            if (tag.kind == Kind::Start) {
+                parse_fields(w, arc);
+            }
+            scene.add(arc);
+            break;
+        }
+        default:
+            error("unknown element", tag.name);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef PLOT_INDEX__H_
+#define PLOT_INDEX__H_
+
+#include "plot.h"
+#include "scene.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Stage one of the indexed parser: the offsets, in order, of every '<', '>',
+// '"' and '\'' in a buffer.  The buffer is classified 64 bytes at a time into
+// a bitmap (four SSE2 compares per character where available) and the set bits
+// are appended, so the cost depends only on the size of the buffer and the
+// number of structural characters, not on how the markup is laid out.
+//
+// Building the index needs nothing from stage two, so it can be done up
+// front or on another thread.  The buffer is classified twice: once to count
+// the structural characters, so that exactly one offset each is allocated,
+// and once to write them out without bounds checks.
+class StructuralIndex {
+public:
+    StructuralIndex();
+
+    // Throws rapidxml::parse_error if size does not fit in 32 bits.
+    void build(const char* text, std::size_t size);
+
+    const std::uint32_t* begin() const { return m_offsets.get(); }
+    const std::uint32_t* end() const { return m_offsets.get() + m_size; }
+    std::size_t size() const { return m_size; }
+
+private:
+    StructuralIndex(const StructuralIndex&) = delete;
+    StructuralIndex& operator=(const StructuralIndex&) = delete;
+
+    std::unique_ptr<std::uint32_t[]> m_offsets;
+    std::size_t m_size;
+    std::size_t m_capacity;
+};
+
+// Parses a ppcPlot document in two stages: the whole buffer is indexed with
+// StructuralIndex, then tags are recovered by walking the offsets rather than
+// the bytes, and field values are written directly into Line/Arc, which are
+// added to scene.  Only the bytes of tag names and values are looked at
+// again.  Comments, processing instructions and the doctype are skipped;
+// quoted attribute values may contain '>'.  text[0, size) need not be zero
+// terminated and is not modified.  Throws rapidxml::parse_error.
+void parse_plot_indexed(const char* text, std::size_t size, Scene& scene);
+
+#endif // PLOT_INDEX__H_
@@ -0,0 +1,270 @@
+#include "plot_parallel.h"
+#include "rapidxml.hpp"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace xml = rapidxml;
+
+// Values are only read through value()/value_size(), so nothing needs to be
+// written into the text, and a range can be handed back untouched.
+const int FLAGS = xml::parse_non_destructive;
+
+// Ranges smaller than this are not worth a thread.
+const std::size_t MIN_RANGE = 1 << 16;
+
+struct Range {
+    // scale as in Scene::scale(), so that results append without conversion.
+    Range(char* first, char* last, int scale)
+        : first(first)
+        , last(last)
+        , scene(scale ? Scene(scale) : Scene())
+        , ok(false)
+        {}
+
+    char* first;
+    char* last; // *last is the borrowed terminator
+    Scene scene;
+    bool ok;
+};
+
+// [first, second) of each comment, CDATA section, PI or doctype.
+typedef std::vector<std::pair<char*, char*>> Specials;
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool starts_with(const char* p, const char* end, const char* prefix) {
+    const std::size_t n = strlen(prefix);
+    return static_cast<std::size_t>(end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+char* find(char* p, char* end, char c) {
+    return static_cast<char*>(memchr(p, c, end - p));
+}
+
+// Adds the <Line>/<Arc> children of parent to scene, ignoring CDATA sections.
+void extract(const xml::xml_node<>* parent, Scene& scene) {
+    for (const xml::xml_node<>* node = parent->first_node(); node; node = node->next_sibling()) {
+        if (node->type() != xml::node_element) {
+            continue;
+        }
+        switch (element_kind(node->name(), node->name_size())) {
+        case Element::Line:
+            scene.add(parse_line(node));
+            break;
+        case Element::Arc:
+            scene.add(parse_arc(node));
+            break;
+        default:
+            throw xml::parse_error("unknown element", node->name());
+        }
+    }
+}
+
+void parse_sequential(char* text, Scene& scene) {
+    xml::xml_document<> doc;
+    doc.parse<FLAGS>(text);
+    const xml::xml_node<>* root = doc.first_node();
+    if (!root) {
+        throw xml::parse_error("no root element", text);
+    }
+    extract(root, scene);
+}
+
+void parse_range(Range& range) {
+    try {
+        xml::xml_document<> doc;
+        doc.parse<FLAGS>(range.first);
+        extract(&doc, range.scene);
+        range.ok = true;
+    } catch (const std::exception&) {
+        range.ok = false;
+    }
+}
+
+// Returns the byte after the comment, CDATA section, PI or doctype starting
+// at p, or nullptr if it is not closed.
+char* skip_special(char* p, char* end) {
+    const char* close = starts_with(p, end, "<!--") ? "-->"
+                      : starts_with(p, end, "<![CDATA[") ? "]]>"
+                      : starts_with(p, end, "<?") ? "?>"
+                      : ">";
+    const std::size_t n = strlen(close);
+    char* hit = static_cast<char*>(memmem(p + 2, end - p - 2, close, n));
+    return hit ? hit + n : nullptr;
+}
+
+// Returns the byte after the root start tag, or nullptr if the prolog is not
+// understood or the root is empty.
+char* children(char* p, char* end) {
+    for (;;) {
+        p = find(p, end, '<');
+        if (!p || p + 1 == end) {
+            return nullptr;
+        }
+        if (p[1] != '!' && p[1] != '?') {
+            break;
+        }
+        p = skip_special(p, end);
+        if (!p) {
+            return nullptr;
+        }
+    }
+    char quote = 0;
+    for (++p; p < end; ++p) {
+        if (quote) {
+            quote = *p == quote ? 0 : quote;
+        } else if (*p == '"' || *p == '\'') {
+            quote = *p;
+        } else if (*p == '>') {
+            return p[-1] == '/' ? nullptr : p + 1;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the '<' of the root end tag, or nullptr unless the document ends
+// with it (plus whitespace).
+char* root_close(char* first, char* end) {
+    char* p = end;
+    while (p > first && is_space(p[-1])) {
+        --p;
+    }
+    if (p == first || p[-1] != '>') {
+        return nullptr;
+    }
+    p = static_cast<char*>(memrchr(first, '<', p - first));
+    return p && p[1] == '/' ? p : nullptr;
+}
+
+// Collects the comments, CDATA sections, PIs and doctypes in [first, last).
+// '!' and '?' are rare in plot files, so this runs at memchr() speed.
+// Returns false if one of them is not closed.
+bool scan_specials(char* first, char* last, Specials& specials) {
+    char* p = first;
+    char* bang = find(p, last, '!');
+    char* question = find(p, last, '?');
+    for (;;) {
+        char* q = !bang ? question : !question ? bang : std::min(bang, question);
+        if (!q) {
+            return true;
+        }
+        if (q > first && q[-1] == '<') {
+            char* close = skip_special(q - 1, last);
+            if (!close) {
+                return false;
+            }
+            specials.push_back(std::make_pair(q - 1, close));
+            p = close;
+        } else {
+            p = q + 1;
+        }
+        if (bang && bang < p) {
+            bang = find(p, last, '!');
+        }
+        if (question && question < p) {
+            question = find(p, last, '?');
+        }
+    }
+}
+
+// Returns the whitespace byte just after the first top-level </Line> or
+// </Arc> at or after p that is outside every special, or nullptr.  j is the
+// first special that may still contain p.
+char* find_cut(char* p, char* last, const Specials& specials, std::size_t& j) {
+    while ((p = find(p, last, '<'))) {
+        while (j < specials.size() && specials[j].second <= p) {
+            ++j;
+        }
+        if (j < specials.size() && specials[j].first <= p) {
+            p = specials[j].second;
+            continue;
+        }
+        const std::size_t tag = starts_with(p, last, "</Line>") ? 7
+                              : starts_with(p, last, "</Arc>") ? 6
+                              : 0;
+        if (tag && p + tag < last && is_space(p[tag])) {
+            return p + tag;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void parse_plot_parallel(char* text, std::size_t size, unsigned threads,
+                         Scene& scene) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    char* const end = text + size;
+    char* const first = threads > 1 && size >= 2 * MIN_RANGE ? children(text, end) : nullptr;
+    char* const last = first ? root_close(first, end) : nullptr;
+    Specials specials;
+    if (!last || last <= first || !scan_specials(first, last, specials)) {
+        parse_sequential(text, scene);
+        return;
+    }
+
+    // Cut at the first boundary after each of count - 1 evenly spaced targets.
+    const std::size_t count = std::min<std::size_t>(threads, (last - first) / MIN_RANGE);
+    std::vector<Range> ranges;
+    ranges.reserve(count);
+    char* from = first;
+    std::size_t j = 0;
+    for (std::size_t k = 1; k < count; ++k) {
+        char* const target = first + (last - first) / count * k;
+        char* const cut = find_cut(std::max(target, from), last, specials, j);
+        if (!cut) {
+            break;
+        }
+        ranges.push_back(Range(from, cut, scene.scale()));
+        from = cut + 1;
+    }
+    ranges.push_back(Range(from, last, scene.scale()));
+    if (ranges.size() == 1) {
+        parse_sequential(text, scene);
+        return;
+    }
+
+    std::vector<char> saved;
+    for (Range& range : ranges) {
+        saved.push_back(*range.last);
+        *range.last = 0;
+    }
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        workers.push_back(std::thread(parse_range, std::ref(ranges[i])));
+    }
+    parse_range(ranges[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        *ranges[i].last = saved[i];
+    }
+
+    std::size_t line_count = scene.line_count();
+    std::size_t arc_count = scene.arc_count();
+    for (const Range& range : ranges) {
+        if (!range.ok) {
+            parse_sequential(text, scene);
+            return;
+        }
+        line_count += range.scene.line_count();
+        arc_count += range.scene.arc_count();
+    }
+    scene.reserve(line_count, arc_count);
+    for (const Range& range : ranges) {
+        scene.append(range.scene);
+    }
+}
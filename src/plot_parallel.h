@@ -0,0 +1,28 @@
+#ifndef PLOT_PARALLEL__H_
+#define PLOT_PARALLEL__H_
+
+#include "plot.h"
+#include "scene.h"
+#include <cstddef>
+
+// Parses a ppcPlot document on up to `threads` threads (0 means one per
+// hardware thread).  The children of the root are cut into ranges at the end
+// of top-level </Line> or </Arc> tags, found with a memchr() pre-scan that
+// steps over comments, CDATA sections and the doctype.  Each range is parsed
+// into its own rapidxml document, and so its own memory_pool, on its own
+// thread, and the per-range primitives are appended to scene in document
+// order.
+//
+// Ranges are parsed with parse_non_destructive, so field values are not
+// entity-expanded.  The byte after each cut is borrowed as the range's
+// terminator and restored before returning.  If a range fails to parse, or
+// the document is too small or oddly shaped to split, the whole document is
+// parsed again on the calling thread, so a bad cut can cost time but never
+// change the result.
+//
+// text must be writable and zero terminated at text[size] (see MappedFile);
+// its contents are unchanged on return.  Throws rapidxml::parse_error.
+void parse_plot_parallel(char* text, std::size_t size, unsigned threads,
+                         Scene& scene);
+
+#endif // PLOT_PARALLEL__H_
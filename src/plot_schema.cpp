@@ -0,0 +1,330 @@
+#include "plot_schema.h"
+#include "decimal.h"
+#include "rapidxml.hpp"
+#include <cstring>
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////
+// Compile-time schema description
+
+struct Tag {
+    const char* name;
+    std::size_t size;
+};
+
+template<std::size_t N>
+constexpr Tag tag(const char (&name)[N]) {
+    return Tag{name, N - 1};
+}
+
+// Every tag of a schema must land in its own slot of a 16-entry table.
+// Length plus first and last character is enough for the ppcPlot grammar;
+// the static_asserts below prove it for each schema.
+const std::size_t SLOTS = 16;
+
+constexpr std::size_t slot(const char* name, std::size_t size) {
+    return (size + static_cast<unsigned char>(name[0])
+                 + static_cast<unsigned char>(name[size - 1])) & (SLOTS - 1);
+}
+
+constexpr std::size_t slot(Tag t) {
+    return slot(t.name, t.size);
+}
+
+// A field is either a number stored in a double member, or the color.
+template<class T>
+struct FieldSpec {
+    Tag tag;
+    double T::*number;
+};
+
+struct LineSchema {
+    typedef Line type;
+    static constexpr std::size_t size = 5;
+    static constexpr FieldSpec<Line> fields[size] = {
+        { tag("XStart"), &Line::x_start },
+        { tag("XEnd"),   &Line::x_end },
+        { tag("YStart"), &Line::y_start },
+        { tag("YEnd"),   &Line::y_end },
+        { tag("Color"),  nullptr },
+    };
+    static constexpr Tag tag_at(std::size_t i) { return fields[i].tag; }
+};
+constexpr FieldSpec<Line> LineSchema::fields[];
+
+struct ArcSchema {
+    typedef Arc type;
+    static constexpr std::size_t size = 6;
+    static constexpr FieldSpec<Arc> fields[size] = {
+        { tag("XCenter"),   &Arc::x_center },
+        { tag("YCenter"),   &Arc::y_center },
+        { tag("Radius"),    &Arc::radius },
+        { tag("ArcStart"),  &Arc::arc_start },
+        { tag("ArcExtend"), &Arc::arc_extend },
+        { tag("Color"),     nullptr },
+    };
+    static constexpr Tag tag_at(std::size_t i) { return fields[i].tag; }
+};
+constexpr FieldSpec<Arc> ArcSchema::fields[];
+
+// Children of the root element; indices match the switch in parse_plot_schema().
+struct PlotSchema {
+    static constexpr std::size_t size = 2;
+    static constexpr Tag tags[size] = {
+        tag("Line"),
+        tag("Arc"),
+    };
+    static constexpr Tag tag_at(std::size_t i) { return tags[i]; }
+};
+constexpr Tag PlotSchema::tags[];
+
+///////////////////////////////////////////////////////////////////////////
+// Dispatch tables, built at compile time from the schemas above
+
+template<std::size_t... I> struct indices {};
+template<std::size_t N, std::size_t... I>
+struct make_indices : make_indices<N - 1, N - 1, I...> {};
+template<std::size_t... I>
+struct make_indices<0, I...> { typedef indices<I...> type; };
+
+struct Table {
+    signed char index[SLOTS]; // tag index for each slot, -1 if unused
+};
+
+template<class Schema>
+constexpr signed char tag_in_slot(std::size_t s, std::size_t i = 0) {
+    return i == Schema::size ? -1
+         : slot(Schema::tag_at(i)) == s ? static_cast<signed char>(i)
+         : tag_in_slot<Schema>(s, i + 1);
+}
+
+template<class Schema, std::size_t... S>
+constexpr Table build_table(indices<S...>) {
+    return Table{{ tag_in_slot<Schema>(S)... }};
+}
+
+template<class Schema>
+constexpr bool unique_slots(std::size_t i = 0, std::size_t j = 1) {
+    return i == Schema::size ? true
+         : j == Schema::size ? unique_slots<Schema>(i + 1, i + 2)
+         : slot(Schema::tag_at(i)) != slot(Schema::tag_at(j)) && unique_slots<Schema>(i, j + 1);
+}
+
+template<class Schema>
+struct Dispatch {
+    static_assert(unique_slots<Schema>(), "schema tags collide in the dispatch table");
+    static constexpr Table table = build_table<Schema>(make_indices<SLOTS>::type());
+};
+template<class Schema>
+constexpr Table Dispatch<Schema>::table;
+
+// Index of name within Schema, or -1 if it is not one of its tags.
+template<class Schema>
+int lookup(const char* name, std::size_t size) {
+    if (size == 0) {
+        return -1;
+    }
+    const int i = Dispatch<Schema>::table.index[slot(name, size)];
+    if (i < 0) {
+        return -1;
+    }
+    const Tag t = Schema::tag_at(i);
+    return t.size == size && memcmp(t.name, name, size) == 0 ? i : -1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Scanning
+
+[[noreturn]] void error(const char* what, const char* where) {
+    throw rapidxml::parse_error(what, const_cast<char*>(where));
+}
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skip_space(const char*& p, const char* end) {
+    while (p < end && is_space(*p)) {
+        ++p;
+    }
+}
+
+// Advance p to the next c.
+void find(const char*& p, const char* end, char c) {
+    const char* hit = static_cast<const char*>(memchr(p, c, end - p));
+    if (!hit) {
+        error("unexpected end of data", end);
+    }
+    p = hit;
+}
+
+// Advance p just past the next occurrence of pattern.
+void skip_past(const char*& p, const char* end, const char* pattern) {
+    const std::size_t n = strlen(pattern);
+    for (;;) {
+        find(p, end, pattern[0]);
+        if (static_cast<std::size_t>(end - p) >= n && memcmp(p, pattern, n) == 0) {
+            p += n;
+            return;
+        }
+        ++p;
+    }
+}
+
+bool starts_with(const char* p, const char* end, const char* prefix) {
+    const std::size_t n = strlen(prefix);
+    return static_cast<std::size_t>(end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+// Reads a tag name at p; returns its size and leaves p on the character after it.
+std::size_t tag_name(const char*& p, const char* end) {
+    const char* name = p;
+    while (p < end && !is_space(*p) && *p != '>' && *p != '/') {
+        ++p;
+    }
+    return p - name;
+}
+
+double to_number(const char* value, const char* value_end) {
+    double result;
+    if (!parse_decimal(value, value_end, result)) {
+        error("invalid number", value);
+    }
+    return result;
+}
+
+// Parses the fields of a <Line> or <Arc> whose start tag has been consumed,
+// up to and including its closing tag.
+template<class Schema>
+void parse_fields(const char*& p, const char* end, typename Schema::type& out) {
+    for (;;) {
+        skip_space(p, end);
+        if (p == end || *p != '<') {
+            error(p == end ? "unexpected end of data" : "expected <", p);
+        }
+        ++p;
+        if (p < end && *p == '/') {
+            find(p, end, '>');
+            ++p;
+            return;
+        }
+        if (starts_with(p, end, "!--")) {
+            skip_past(p, end, "-->");
+            continue;
+        }
+
+        const char* name = p;
+        const int i = lookup<Schema>(name, tag_name(p, end));
+        if (i < 0) {
+            error("unknown field", name);
+        }
+        find(p, end, '>');
+        if (p[-1] == '/') {
+            ++p; // <Field/> leaves the default value
+            continue;
+        }
+        ++p;
+
+        const char* value = p;
+        find(p, end, '<');
+        const char* value_end = p;
+        while (value < value_end && is_space(*value)) {
+            ++value;
+        }
+        while (value_end > value && is_space(value_end[-1])) {
+            --value_end;
+        }
+        const FieldSpec<typename Schema::type>& field = Schema::fields[i];
+        if (field.number) {
+            out.*field.number = to_number(value, value_end);
+        } else {
+            out.color = translate_color(value, value_end - value);
+        }
+
+        if (p + 1 >= end || p[1] != '/') {
+            error("expected closing tag", p);
+        }
+        find(p, end, '>');
+        ++p;
+    }
+}
+
+} // namespace
+
+void parse_plot_schema(const char* text, std::size_t size, Scene& scene) {
+    const char* p = text;
+    const char* const end = text + size;
+
+    // Prolog, up to and including the root start tag
+    if (starts_with(p, end, "\xEF\xBB\xBF")) {
+        p += 3;
+    }
+    for (;;) {
+        skip_space(p, end);
+        if (p == end) {
+            error("no root element", p);
+        }
+        if (*p != '<') {
+            error("expected <", p);
+        }
+        if (starts_with(p, end, "<?")) {
+            skip_past(p, end, "?>");
+        } else if (starts_with(p, end, "<!--")) {
+            skip_past(p, end, "-->");
+        } else if (starts_with(p, end, "<!")) {
+            find(p, end, '>');
+            ++p;
+        } else {
+            find(p, end, '>');
+            if (p[-1] == '/') {
+                return; // <ppcPlot/>
+            }
+            ++p;
+            break;
+        }
+    }
+
+    // Root children
+    for (;;) {
+        skip_space(p, end);
+        if (p == end || *p != '<') {
+            error(p == end ? "unexpected end of data" : "expected <", p);
+        }
+        ++p;
+        if (p < end && *p == '/') {
+            return; // </ppcPlot>; anything after it is ignored
+        }
+        if (starts_with(p, end, "!--")) {
+            skip_past(p, end, "-->");
+            continue;
+        }
+
+        const char* name = p;
+        const int i = lookup<PlotSchema>(name, tag_name(p, end));
+        if (i < 0) {
+            error("unknown element", name);
+        }
+        find(p, end, '>');
+        const bool empty = p[-1] == '/';
+        ++p;
+        switch (i) {
+        case 0: {
+            Line line;
+            if (!empty) {
+                parse_fields<LineSchema>(p, end, line);
+            }
+            scene.add(line);
+            break;
+        }
+        case 1: {
+            Arc arc;
+            if (!empty) {
+                parse_fields<ArcSchema>(p, end, arc);
+            }
+            scene.add(arc);
+            break;
+        }
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef PLOT_SCHEMA__H_
+#define PLOT_SCHEMA__H_
+
+#include "plot.h"
+#include "scene.h"
+#include <cstddef>
+
+// Parses a ppcPlot document into scene in a single pass specialised for its
+// fixed grammar: element and field tags are recognised straight from the
+// bytes through dispatch tables computed at compile time, and values are
+// written directly into Line/Arc.  No DOM is built and the text is not
+// modified.  text[0, size) need not be zero terminated.  Throws
+// rapidxml::parse_error.
+void parse_plot_schema(const char* text, std::size_t size, Scene& scene);
+
+#endif // PLOT_SCHEMA__H_
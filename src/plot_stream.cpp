@@ -0,0 +1,226 @@
+#include "plot_stream.h"
+#include "rapidxml.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool starts_with(const char* p, const char* end, const char* prefix) {
+    const std::size_t n = strlen(prefix);
+    return static_cast<std::size_t>(end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+} // namespace
+
+const std::size_t PlotStream::DEFAULT_WINDOW;
+
+PlotStream::PlotStream(std::size_t window)
+    : m_window(window)
+    , m_buffer(new char[window + 1])
+    , m_pos(nullptr)
+    , m_end(nullptr)
+    , m_fd(-1)
+    , m_eof(false)
+    , m_in_root(false)
+    , m_done(false)
+    {}
+
+PlotStream::~PlotStream() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool PlotStream::run(const std::string& filename,
+                     const LineHandler& on_line,
+                     const ArcHandler& on_arc) {
+    m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        return fail("Unable to open: " + filename);
+    }
+    m_pos = m_end = m_buffer.get();
+    m_eof = m_in_root = m_done = false;
+    m_error.clear();
+
+    bool ok = true;
+    while (ok && !m_done) {
+        switch (step(on_line, on_arc)) {
+        case Step::Progress:
+            break;
+        case Step::NeedMore:
+            if (!fill()) {
+                if (m_error.empty()) {
+                    fail("unexpected end of data");
+                }
+                ok = false;
+            }
+            break;
+        case Step::Failed:
+            ok = false;
+            break;
+        }
+    }
+
+    ::close(m_fd);
+    m_fd = -1;
+    return ok;
+}
+
+PlotStream::Step PlotStream::step(const LineHandler& on_line, const ArcHandler& on_arc) {
+    while (m_pos < m_end && is_space(*m_pos)) {
+        ++m_pos;
+    }
+    if (m_end - m_pos < 4) {
+        // Enough to tell "<!--" from "</x>" from "<x>"; at EOF run() reports
+        // whatever is left as truncated.
+        if (!m_eof || m_pos == m_end) {
+            return Step::NeedMore;
+        }
+    }
+    if (*m_pos != '<') {
+        fail(m_in_root ? "unexpected text in root element" : "expected <");
+        return Step::Failed;
+    }
+
+    const char* close = nullptr;
+    if (starts_with(m_pos, m_end, "<!--")) {
+        if (!(close = find(m_pos + 4, "-->"))) {
+            return Step::NeedMore;
+        }
+        m_pos = const_cast<char*>(close) + 3;
+    } else if (starts_with(m_pos, m_end, "<?") || starts_with(m_pos, m_end, "<!")) {
+        if (m_in_root) {
+            fail("unexpected markup in root element");
+            return Step::Failed;
+        }
+        if (!(close = find(m_pos + 2, ">"))) {
+            return Step::NeedMore;
+        }
+        m_pos = const_cast<char*>(close) + 1;
+    } else if (starts_with(m_pos, m_end, "</")) {
+        if (!(close = find(m_pos + 2, ">"))) {
+            return Step::NeedMore;
+        }
+        m_pos = const_cast<char*>(close) + 1;
+        m_done = true;
+    } else if (!m_in_root) {
+        // Root start tag, e.g. <ppcPlot xmlns:xsi="...">
+        if (!(close = find(m_pos + 1, ">"))) {
+            return Step::NeedMore;
+        }
+        m_done = close[-1] == '/';
+        m_in_root = true;
+        m_pos = const_cast<char*>(close) + 1;
+    } else {
+        return element(on_line, on_arc);
+    }
+    return Step::Progress;
+}
+
+PlotStream::Step PlotStream::element(const LineHandler& on_line, const ArcHandler& on_arc) {
+    char* name = m_pos + 1;
+    char* name_end = name;
+    while (name_end < m_end && !is_space(*name_end) && *name_end != '>' && *name_end != '/') {
+        ++name_end;
+    }
+    if (name_end == m_end) {
+        return Step::NeedMore;
+    }
+
+    const std::string tag(name, name_end);
+    const bool is_line = tag == "Line";
+    const bool is_arc = tag == "Arc";
+    if (!is_line && !is_arc) {
+        fail("Unknown element: " + tag);
+        return Step::Failed;
+    }
+
+    const char* open_end = find(name_end, ">");
+    if (!open_end) {
+        return Step::NeedMore;
+    }
+    char* end = const_cast<char*>(open_end) + 1;
+    if (open_end[-1] != '/') {
+        const std::string closing = "</" + tag;
+        const char* close = open_end;
+        do {
+            close = find(close + 1, closing.c_str());
+            if (!close) {
+                return Step::NeedMore;
+            }
+        } while (close + closing.size() < m_end &&
+                 !is_space(close[closing.size()]) && close[closing.size()] != '>');
+        const char* close_end = find(close + closing.size(), ">");
+        if (!close_end) {
+            return Step::NeedMore;
+        }
+        end = const_cast<char*>(close_end) + 1;
+    }
+
+    if ((is_line && on_line) || (is_arc && on_arc)) {
+        // Parse just this element; rapidxml needs a terminator, so borrow the
+        // byte after it for the duration of the parse.
+        const char saved = *end;
+        *end = 0;
+        try {
+            rapidxml::xml_document<> doc;
+            doc.parse<0>(m_pos);
+            if (is_line) {
+                on_line(parse_line(doc.first_node()));
+            } else {
+                on_arc(parse_arc(doc.first_node()));
+            }
+        } catch (const rapidxml::parse_error& ex) {
+            *end = saved;
+            fail(std::string("parse error: ") + ex.what());
+            return Step::Failed;
+        }
+        *end = saved;
+    }
+    m_pos = end;
+    return Step::Progress;
+}
+
+bool PlotStream::fill() {
+    if (m_eof) {
+        return false;
+    }
+    char* const begin = m_buffer.get();
+    if (m_pos != begin) {
+        std::memmove(begin, m_pos, m_end - m_pos);
+        m_end -= m_pos - begin;
+        m_pos = begin;
+    }
+    const std::size_t room = m_window - (m_end - begin);
+    if (room == 0) {
+        return fail("element larger than the " + std::to_string(m_window) + " byte window");
+    }
+    ssize_t n;
+    do {
+        n = ::read(m_fd, m_end, room);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        return fail(std::string("read failed: ") + strerror(errno));
+    }
+    m_eof = n == 0;
+    m_end += n;
+    return true;
+}
+
+const char* PlotStream::find(const char* from, const char* pattern) const {
+    const char* end = m_end;
+    const char* hit = std::search(from, end, pattern, pattern + strlen(pattern));
+    return hit == end ? nullptr : hit;
+}
+
+bool PlotStream::fail(const std::string& what) {
+    m_error = what;
+    return false;
+}
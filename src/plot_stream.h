@@ -0,0 +1,62 @@
+#ifndef PLOT_STREAM__H_
+#define PLOT_STREAM__H_
+
+#include "plot.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Reads a ppcPlot document through a fixed-size window instead of loading it
+// whole.  Each complete <Line>/<Arc> child of the root is parsed on its own
+// into a scratch rapidxml document, handed to the caller and then dropped
+// together with its bytes, so peak memory is bounded by the window size
+// regardless of how large the file is.  A single element must fit in the
+// window.
+class PlotStream {
+public:
+    typedef std::function<void(const Line&)> LineHandler;
+    typedef std::function<void(const Arc&)> ArcHandler;
+
+    static const std::size_t DEFAULT_WINDOW = 1 << 20;
+
+    explicit PlotStream(std::size_t window = DEFAULT_WINDOW);
+    ~PlotStream();
+
+    // Streams filename, calling on_line/on_arc in document order.  Elements
+    // whose handler is empty are skipped without being parsed.  Returns false
+    // on error; error() then describes what went wrong.
+    bool run(const std::string& filename,
+             const LineHandler& on_line,
+             const ArcHandler& on_arc);
+
+    const std::string& error() const { return m_error; }
+
+private:
+    PlotStream(const PlotStream&) = delete;
+    PlotStream& operator=(const PlotStream&) = delete;
+
+    enum class Step {
+        Progress,
+        NeedMore,
+        Failed
+    };
+
+    Step step(const LineHandler& on_line, const ArcHandler& on_arc);
+    Step element(const LineHandler& on_line, const ArcHandler& on_arc);
+    bool fill();
+    const char* find(const char* from, const char* pattern) const;
+    bool fail(const std::string& what);
+
+    std::size_t m_window;
+    std::unique_ptr<char[]> m_buffer;
+    char* m_pos;        // first unconsumed byte
+    char* m_end;        // one past the last byte read
+    int m_fd;
+    bool m_eof;
+    bool m_in_root;
+    bool m_done;
+    std::string m_error;
+};
+
+#endif // PLOT_STREAM__H_
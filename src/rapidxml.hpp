@@ -13,6 +13,22 @@
     #include <new>          // For placement new
 #endif
 
+///////////////////////////////////////////////////////////////////////////
+// SIMD
+
+// Character scans are vectorized with SSE2, or AVX2 if the CPU supports it (detected at runtime).
+// Define RAPIDXML_NO_SIMD before including rapidxml.hpp to use plain lookup tables only.
+#if !defined(RAPIDXML_NO_SIMD) && defined(__SSE2__) && defined(__GNUC__)
+    #define RAPIDXML_SIMD
+    #include <immintrin.h>
+#endif
+
+#ifndef RAPIDXML_SIMD_MIN_RUN
+    // Number of characters tested one at a time before a skip switches to vector compares.
+    // Define RAPIDXML_SIMD_MIN_RUN before including rapidxml.hpp if you want to override the default value.
+    #define RAPIDXML_SIMD_MIN_RUN 16
+#endif
+
 // On MSVC, disable "conditional expression is constant" warning (level 4). 
 // This warning is almost impossible to avoid with certain types of templated code
 #ifdef _MSC_VER
@@ -131,6 +147,19 @@ namespace rapidxml
     #define RAPIDXML_ALIGNMENT sizeof(void *)
 #endif
 
+// memory_pool can back its dynamic blocks with huge pages on Linux, see memory_pool::set_huge_pages().
+// Define RAPIDXML_NO_HUGE_PAGES before including rapidxml.hpp to leave that support out.
+#if !defined(RAPIDXML_NO_HUGE_PAGES) && defined(__linux__)
+    #define RAPIDXML_HUGE_PAGES
+    #include <sys/mman.h>
+#endif
+
+#ifndef RAPIDXML_HUGE_PAGE_SIZE
+    // Size of a huge page; dynamic blocks backed by huge pages are rounded up to a multiple of it.
+    // Define RAPIDXML_HUGE_PAGE_SIZE before including rapidxml.hpp if you want to override the default value.
+    #define RAPIDXML_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
 namespace rapidxml
 {
     // Forward declarations
@@ -246,6 +275,16 @@ namespace rapidxml
     //! See xml_document::parse() function.
     const int parse_normalize_whitespace = 0x800;
 
+    //! Parse flag instructing the parser to intern element names in the document's atom table.
+    //! All elements with the same name then share one zero terminated copy of it, allocated from the document's memory pool.
+    //! Pass that copy, obtained with xml_document::atom(), to xml_node::first_node_atom() and xml_node::next_sibling_atom()
+    //! to look up children by comparing a single pointer instead of the name.
+    //! By default, element names point into the source text.
+    //! Can be combined with other flags by use of | operator.
+    //! <br><br>
+    //! See xml_document::parse() function.
+    const int parse_intern_names = 0x1000;
+
     // Compound flags
     
     //! Parse flags which represent default behaviour of the parser. 
@@ -305,6 +344,119 @@ namespace rapidxml
             static const unsigned char lookup_upcase[256];                  // To uppercase conversion table for ASCII characters
         };
 
+        // Set of characters that vectorized skip compares against.
+        // If Skip is true, characters are skipped while they are in the set (e.g. whitespace);
+        // otherwise they are skipped until one in the set is found (e.g. end of name).
+        // Sets must agree with the corresponding lookup tables, including the zero terminator.
+        template<bool Skip, char... Chars>
+        struct simd_set
+        {
+        };
+
+        // Predicates that are not vectorized
+        struct no_simd
+        {
+        };
+
+#if defined(RAPIDXML_SIMD)
+
+        // Byte mask of characters in a block that are equal to any of Chars
+        template<char... Chars>
+        struct any_of;
+
+        template<char C>
+        struct any_of<C>
+        {
+            static __m128i test(__m128i block)
+            {
+                return _mm_cmpeq_epi8(block, _mm_set1_epi8(C));
+            }
+            __attribute__((target("avx2"))) static __m256i test(__m256i block)
+            {
+                return _mm256_cmpeq_epi8(block, _mm256_set1_epi8(C));
+            }
+        };
+
+        template<char C, char... Rest>
+        struct any_of<C, Rest...>
+        {
+            static __m128i test(__m128i block)
+            {
+                return _mm_or_si128(any_of<C>::test(block), any_of<Rest...>::test(block));
+            }
+            __attribute__((target("avx2"))) static __m256i test(__m256i block)
+            {
+                return _mm256_or_si256(any_of<C>::test(block), any_of<Rest...>::test(block));
+            }
+        };
+
+        // Features of the running CPU, detected once at startup.
+        // Until then (i.e. when parsing from static constructors in other translation units) they read as false,
+        // which selects the baseline SSE2 code.
+        template<int Dummy>
+        struct cpu_features
+        {
+            static const bool avx2;
+        };
+
+        template<int Dummy>
+        const bool cpu_features<Dummy>::avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+
+        template<class Set>
+        struct simd_skip;
+
+        // Skips characters using aligned loads only. 
+        // An aligned block never crosses a page boundary, so bytes past the zero terminator that share its block
+        // are safe to read; they are masked off by the terminator test, which is part of every set.
+        template<bool Skip, char... Chars>
+        struct simd_skip<simd_set<Skip, Chars...> >
+        {
+            static const char *skip(const char *text)
+            {
+                return cpu_features<0>::avx2 ? skip_avx2(text) : skip_sse2(text);
+            }
+
+            static const char *skip_sse2(const char *text)
+            {
+                std::size_t offset = reinterpret_cast<std::size_t>(text) & 15;
+                const char *block = text - offset;
+                unsigned mask = stops(_mm_load_si128(reinterpret_cast<const __m128i *>(block))) & (0xFFFFu << offset);
+                while (!mask)
+                {
+                    block += 16;
+                    mask = stops(_mm_load_si128(reinterpret_cast<const __m128i *>(block)));
+                }
+                return block + __builtin_ctz(mask);
+            }
+
+            __attribute__((target("avx2"))) static const char *skip_avx2(const char *text)
+            {
+                std::size_t offset = reinterpret_cast<std::size_t>(text) & 31;
+                const char *block = text - offset;
+                unsigned mask = stops(_mm256_load_si256(reinterpret_cast<const __m256i *>(block))) & (0xFFFFFFFFu << offset);
+                while (!mask)
+                {
+                    block += 32;
+                    mask = stops(_mm256_load_si256(reinterpret_cast<const __m256i *>(block)));
+                }
+                return block + __builtin_ctz(mask);
+            }
+
+            // Bit mask of characters where skipping must stop
+            static unsigned stops(__m128i block)
+            {
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(any_of<Chars...>::test(block)));
+                return Skip ? ~mask & 0xFFFFu : mask;
+            }
+            __attribute__((target("avx2"))) static unsigned stops(__m256i block)
+            {
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(any_of<Chars...>::test(block)));
+                return Skip ? ~mask : mask;
+            }
+        };
+
+#endif
+
         // Find length of the string
         template<class Ch>
         inline std::size_t measure(const Ch *p)
@@ -335,6 +487,16 @@ namespace rapidxml
             }
             return true;
         }
+
+        // Hash string for the atom table and child indices (FNV-1a)
+        template<class Ch>
+        inline std::size_t hash(const Ch *p, std::size_t size)
+        {
+            std::size_t result = 2166136261u;
+            for (std::size_t i = 0; i < size; ++i)
+                result = (result ^ static_cast<std::size_t>(p[i])) * 16777619u;
+            return result;
+        }
     }
     //! \endcond
 
@@ -364,6 +526,12 @@ namespace rapidxml
     //! by using global <code>new[]</code> and <code>delete[]</code> operators. 
     //! This behaviour can be changed by setting custom allocation routines. 
     //! Use set_allocator() function to set them.
+    //! The size of dynamic blocks can also be changed at runtime with set_block_size(),
+    //! and on Linux they can be backed by huge pages, see set_huge_pages().
+    //! <br><br>
+    //! Programs that parse many documents one after another can call reset() instead of clear() between them.
+    //! It keeps the dynamic blocks and hands them out again, so once the pool has grown to fit the largest document
+    //! no further memory is allocated. reserve() grows it to a known size up front.
     //! <br><br>
     //! Allocations for nodes, attributes and strings are aligned at <code>RAPIDXML_ALIGNMENT</code> bytes.
     //! This value defaults to the size of pointer on target architecture.
@@ -388,7 +556,10 @@ namespace rapidxml
         
         //! Constructs empty pool with default allocator functions.
         memory_pool()
-            : m_alloc_func(0)
+            : m_spare(0)
+            , m_block_size(RAPIDXML_DYNAMIC_POOL_SIZE)
+            , m_huge_pages(false)
+            , m_alloc_func(0)
             , m_free_func(0)
         {
             init();
@@ -526,16 +697,70 @@ namespace rapidxml
         {
             while (m_begin != m_static_memory)
             {
-                char *previous_begin = reinterpret_cast<header *>(align(m_begin))->previous_begin;
-                if (m_free_func)
-                    m_free_func(m_begin);
-                else
-                    delete[] m_begin;
+                char *previous_begin = block_header(m_begin)->previous_begin;
+                free_block(m_begin);
+                m_begin = previous_begin;
+            }
+            while (m_spare)
+            {
+                char *next = block_header(m_spare)->previous_begin;
+                free_block(m_spare);
+                m_spare = next;
+            }
+            init();
+        }
+
+        //! Rewinds the pool, keeping its memory for reuse.
+        //! Like clear(), this invalidates all nodes, attributes and strings allocated from the pool,
+        //! but dynamic blocks are not freed. They are handed out again, in the order they were first allocated,
+        //! before any new block is allocated.
+        void reset()
+        {
+            while (m_begin != m_static_memory)
+            {
+                header *block = block_header(m_begin);
+                char *previous_begin = block->previous_begin;
+                block->previous_begin = m_spare;
+                m_spare = m_begin;
                 m_begin = previous_begin;
             }
             init();
         }
 
+        //! Makes sure that a dynamic block able to hold at least size bytes of allocations is available,
+        //! allocating one now if the pool has none.
+        //! A pool reserved for the size of a document parses it with no further allocation once static memory is exhausted.
+        //! \param size Number of bytes.
+        void reserve(std::size_t size)
+        {
+            for (char *spare = m_spare; spare; spare = block_header(spare)->previous_begin)
+                if (capacity(spare) >= size)
+                    return;
+            char *raw_memory = allocate_block(size);
+            block_header(raw_memory)->previous_begin = m_spare;
+            m_spare = raw_memory;
+        }
+
+        //! Sets the size of dynamic blocks allocated from now on, which defaults to <code>RAPIDXML_DYNAMIC_POOL_SIZE</code>.
+        //! Larger blocks mean fewer allocations and longer contiguous runs of nodes.
+        //! \param size Size of a block in bytes; allocations larger than this get a block of their own.
+        void set_block_size(std::size_t size)
+        {
+            assert(size > 0);
+            m_block_size = size;
+        }
+
+        //! Enables or disables backing dynamic blocks allocated from now on with huge pages.
+        //! Blocks are rounded up to a multiple of <code>RAPIDXML_HUGE_PAGE_SIZE</code> and mapped with <code>MAP_HUGETLB</code>;
+        //! if no huge pages are reserved, an ordinary mapping advised with <code>MADV_HUGEPAGE</code> is used instead.
+        //! This bypasses the allocator functions. It has no effect unless <code>RAPIDXML_HUGE_PAGES</code> is defined,
+        //! which is the default on Linux.
+        //! \param enable True to use huge pages.
+        void set_huge_pages(bool enable)
+        {
+            m_huge_pages = enable;
+        }
+
         //! Sets or resets the user-defined memory allocation functions for the pool.
         //! This can only be called when no memory is allocated from the pool yet, otherwise results are undefined.
         //! Allocation function must not return invalid pointer on failure. It should either throw,
@@ -551,7 +776,7 @@ namespace rapidxml
         //! \param ff Free function, or 0 to restore default function
         void set_allocator(alloc_func *af, free_func *ff)
         {
-            assert(m_begin == m_static_memory && m_ptr == align(m_begin));    // Verify that no memory is allocated yet
+            assert(m_begin == m_static_memory && m_ptr == align(m_begin) && !m_spare);    // Verify that no memory is allocated yet
             m_alloc_func = af;
             m_free_func = ff;
         }
@@ -560,7 +785,9 @@ namespace rapidxml
 
         struct header
         {
-            char *previous_begin;
+            char *previous_begin;       // Previous block in use, or next spare block
+            std::size_t size;           // Size of raw memory of this block
+            bool mapped;                // Whether the block was mapped with huge pages
         };
 
         void init()
@@ -596,6 +823,82 @@ namespace rapidxml
             return static_cast<char *>(memory);
         }
         
+        header *block_header(char *raw_memory)
+        {
+            return reinterpret_cast<header *>(align(raw_memory));
+        }
+
+        // Number of bytes that can be allocated from a dynamic block
+        std::size_t capacity(char *raw_memory)
+        {
+            return block_header(raw_memory)->size - sizeof(header) - (2 * RAPIDXML_ALIGNMENT - 2);
+        }
+
+        // Allocates a dynamic block able to hold pool_size bytes and fills in its header, except previous_begin
+        char *allocate_block(std::size_t pool_size)
+        {
+            std::size_t alloc_size = sizeof(header) + (2 * RAPIDXML_ALIGNMENT - 2) + pool_size;     // 2 alignments required in worst case: one for header, one for actual allocation
+            char *raw_memory = 0;
+            bool mapped = false;
+#ifdef RAPIDXML_HUGE_PAGES
+            if (m_huge_pages)
+            {
+                std::size_t map_size = (alloc_size + RAPIDXML_HUGE_PAGE_SIZE - 1) / RAPIDXML_HUGE_PAGE_SIZE * RAPIDXML_HUGE_PAGE_SIZE;
+                void *memory = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (memory == MAP_FAILED)
+                {
+                    // No huge pages reserved, ask for transparent ones
+                    memory = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (memory != MAP_FAILED)
+                        madvise(memory, map_size, MADV_HUGEPAGE);
+                }
+                if (memory != MAP_FAILED)
+                {
+                    raw_memory = static_cast<char *>(memory);
+                    alloc_size = map_size;
+                    mapped = true;
+                }
+            }
+#endif
+            if (!raw_memory)
+                raw_memory = allocate_raw(alloc_size);
+            header *new_header = block_header(raw_memory);
+            new_header->size = alloc_size;
+            new_header->mapped = mapped;
+            return raw_memory;
+        }
+
+        void free_block(char *raw_memory)
+        {
+#ifdef RAPIDXML_HUGE_PAGES
+            header *block = block_header(raw_memory);
+            if (block->mapped)
+            {
+                munmap(raw_memory, block->size);
+                return;
+            }
+#endif
+            if (m_free_func)
+                m_free_func(raw_memory);
+            else
+                delete[] raw_memory;
+        }
+
+        // Unlinks and returns the first spare block able to hold pool_size bytes, or 0 if there is none
+        char *take_spare(std::size_t pool_size)
+        {
+            for (char **link = &m_spare; *link; link = &block_header(*link)->previous_begin)
+            {
+                if (capacity(*link) >= pool_size)
+                {
+                    char *raw_memory = *link;
+                    *link = block_header(raw_memory)->previous_begin;
+                    return raw_memory;
+                }
+            }
+            return 0;
+        }
+
         void *allocate_aligned(std::size_t size)
         {
             // Calculate aligned pointer
@@ -604,14 +907,15 @@ namespace rapidxml
             // If not enough memory left in current pool, allocate a new pool
             if (result + size > m_end)
             {
-                // Calculate required pool size (may be bigger than RAPIDXML_DYNAMIC_POOL_SIZE)
-                std::size_t pool_size = RAPIDXML_DYNAMIC_POOL_SIZE;
+                // Calculate required pool size (may be bigger than the block size)
+                std::size_t pool_size = m_block_size;
                 if (pool_size < size)
                     pool_size = size;
                 
-                // Allocate
-                std::size_t alloc_size = sizeof(header) + (2 * RAPIDXML_ALIGNMENT - 2) + pool_size;     // 2 alignments required in worst case: one for header, one for actual allocation
-                char *raw_memory = allocate_raw(alloc_size);
+                // Reuse a spare block, or allocate
+                char *raw_memory = take_spare(size);
+                if (!raw_memory)
+                    raw_memory = allocate_block(pool_size);
                     
                 // Setup new pool in allocated memory
                 char *pool = align(raw_memory);
@@ -619,7 +923,7 @@ namespace rapidxml
                 new_header->previous_begin = m_begin;
                 m_begin = raw_memory;
                 m_ptr = pool + sizeof(header);
-                m_end = raw_memory + alloc_size;
+                m_end = raw_memory + new_header->size;
 
                 // Calculate aligned pointer again using new pool
                 result = align(m_ptr);
@@ -634,15 +938,95 @@ namespace rapidxml
         char *m_ptr;                                        // First free byte in current pool
         char *m_end;                                        // One past last available byte in current pool
         char m_static_memory[RAPIDXML_STATIC_POOL_SIZE];    // Static raw memory
+        char *m_spare;                                      // First dynamic block kept by reset() for reuse, or 0 if none
+        std::size_t m_block_size;                           // Size of dynamic blocks
+        bool m_huge_pages;                                  // Whether dynamic blocks are backed by huge pages
         alloc_func *m_alloc_func;                           // Allocator function, or 0 if default is to be used
         free_func *m_free_func;                             // Free function, or 0 if default is to be used
     };
 
+    ///////////////////////////////////////////////////////////////////////////
+    // String reference
+
+    //! Reference to a string that does not have to be zero-terminated: a pointer and a length, like C++17 std::basic_string_view.
+    //! xml_base::name_ref() and xml_base::value_ref() return it, so that names and values can be used safely
+    //! whether or not terminators were written, as when parsing with rapidxml::parse_non_destructive flag from read-only memory.
+    //! It is valid for as long as the string it refers to.
+    //! \param Ch Character type to use.
+    template<class Ch = char>
+    class string_ref
+    {
+
+    public:
+
+        //! Constructs a reference to size characters starting at data.
+        string_ref(const Ch *data, std::size_t size)
+            : m_data(data)
+            , m_size(size)
+        {
+        }
+
+        //! Gets first character; it is not followed by a terminator in general.
+        const Ch *data() const
+        {
+            return m_data;
+        }
+
+        //! Gets number of characters.
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        //! Tests if there are no characters.
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        //! Gets first character, for iteration.
+        const Ch *begin() const
+        {
+            return m_data;
+        }
+
+        //! Gets one past the last character, for iteration.
+        const Ch *end() const
+        {
+            return m_data + m_size;
+        }
+
+        //! Gets character at given position, which must be less than size().
+        Ch operator [](std::size_t i) const
+        {
+            assert(i < m_size);
+            return m_data[i];
+        }
+
+        //! Compares case-sensitively with a zero-terminated string.
+        bool operator ==(const Ch *string) const
+        {
+            return internal::compare(m_data, m_size, string, internal::measure(string), true);
+        }
+
+        //! Compares case-sensitively with a zero-terminated string.
+        bool operator !=(const Ch *string) const
+        {
+            return !(*this == string);
+        }
+
+    private:
+
+        const Ch *m_data;       // First character
+        std::size_t m_size;     // Number of characters
+
+    };
+
     ///////////////////////////////////////////////////////////////////////////
     // XML base
 
     //! Base class for xml_node and xml_attribute implementing common functions: 
-    //! name(), name_size(), value(), value_size() and parent().
+    //! name(), name_size(), value(), value_size(), name_ref(), value_ref() and parent().
     //! \param Ch Character type to use
     template<class Ch = char>
     class xml_base
@@ -702,6 +1086,22 @@ namespace rapidxml
             return m_value ? m_value_size : 0;
         }
 
+        //! Gets name of the node as a pointer and a length.
+        //! Unlike name(), the result can be used without a terminator, so it is safe with rapidxml::parse_no_string_terminators.
+        //! \return Name of node, empty if node has no name.
+        string_ref<Ch> name_ref() const
+        {
+            return string_ref<Ch>(name(), name_size());
+        }
+
+        //! Gets value of the node as a pointer and a length.
+        //! Unlike value(), the result can be used without a terminator, so it is safe with rapidxml::parse_no_string_terminators.
+        //! \return Value of node, empty if node has no value.
+        string_ref<Ch> value_ref() const
+        {
+            return string_ref<Ch>(value(), value_size());
+        }
+
         ///////////////////////////////////////////////////////////////////////////
         // Node modification
     
@@ -716,12 +1116,17 @@ namespace rapidxml
         //! <br><br>
         //! Size of name must be specified separately, because name does not have to be zero terminated.
         //! Use name(const Ch *) function to have the length automatically calculated (string must be zero terminated).
+        //! <br><br>
+        //! Renaming a child node drops the child index of its parent (see xml_node::first_node_indexed()).
+        //! Renaming an attribute drops that of its element, which is only rebuilt by the next indexed query.
         //! \param name Name of node to set. Does not have to be zero terminated.
         //! \param size Size of name, in characters. This does not include zero terminator, if one is present.
         void name(const Ch *name, std::size_t size)
         {
             m_name = const_cast<Ch *>(name);
             m_name_size = size;
+            if (m_parent)
+                m_parent->m_indexed = false;
         }
 
         //! Sets name of node to a zero-terminated string.
@@ -875,6 +1280,92 @@ namespace rapidxml
     
     };
 
+    //! \cond internal
+    namespace internal
+    {
+
+        // Open addressing hash table from child name to first child with that name, see xml_node::first_node_indexed().
+        // Table and slots are allocated from the memory pool of the document, and abandoned there when replaced.
+        template<class Ch>
+        struct child_index
+        {
+            memory_pool<Ch> *pool;      // Pool of the document
+            xml_node<Ch> **slots;       // First child with each name, or 0 if slot is empty
+            std::size_t capacity;       // Number of slots, a power of 2
+            std::size_t names;          // Number of distinct names
+            std::size_t count;          // Number of children
+
+            // Indexes the given child and its next siblings
+            static child_index *build(memory_pool<Ch> *pool, xml_node<Ch> *first)
+            {
+                child_index *index = allocate<child_index>(pool, 1);
+                index->pool = pool;
+                index->slots = 0;
+                index->capacity = 0;
+                index->names = 0;
+                index->count = 0;
+                index->grow();
+                for (xml_node<Ch> *child = first; child; child = child->next_sibling())
+                    index->add(child, false);
+                return index;
+            }
+
+            // Returns the slot holding the child with the given name, or the empty slot where it belongs
+            xml_node<Ch> **find(const Ch *name, std::size_t size) const
+            {
+                std::size_t mask = capacity - 1;
+                for (std::size_t i = hash(name, size) & mask; ; i = (i + 1) & mask)
+                {
+                    xml_node<Ch> **slot = slots + i;
+                    if (!*slot || compare((*slot)->name(), (*slot)->name_size(), name, size, true))
+                        return slot;
+                }
+            }
+
+            // Records a new child, which is the first of its name if first is true
+            void add(xml_node<Ch> *child, bool first)
+            {
+                ++count;
+                xml_node<Ch> **slot = find(child->name(), child->name_size());
+                if (!*slot)
+                {
+                    if (2 * (names + 1) > capacity)
+                    {
+                        grow();
+                        slot = find(child->name(), child->name_size());
+                    }
+                    ++names;
+                    *slot = child;
+                }
+                else if (first)
+                    *slot = child;
+            }
+
+            // Doubles the number of slots
+            void grow()
+            {
+                xml_node<Ch> **old_slots = slots;
+                std::size_t old_capacity = capacity;
+                capacity = old_capacity ? 2 * old_capacity : 16;
+                slots = allocate<xml_node<Ch> *>(pool, capacity);
+                for (std::size_t i = 0; i < capacity; ++i)
+                    slots[i] = 0;
+                for (std::size_t i = 0; i < old_capacity; ++i)
+                    if (old_slots[i])
+                        *find(old_slots[i]->name(), old_slots[i]->name_size()) = old_slots[i];
+            }
+
+            // The pool only hands out strings; they are aligned to RAPIDXML_ALIGNMENT, which suits pointers
+            template<class T>
+            static T *allocate(memory_pool<Ch> *pool, std::size_t count)
+            {
+                return reinterpret_cast<T *>(pool->allocate_string(0, (count * sizeof(T) + sizeof(Ch) - 1) / sizeof(Ch)));
+            }
+        };
+
+    }
+    //! \endcond
+
     ///////////////////////////////////////////////////////////////////////////
     // XML node
 
@@ -890,6 +1381,8 @@ namespace rapidxml
     class xml_node: public xml_base<Ch>
     {
 
+        friend class xml_base<Ch>;     // Renaming a node drops the child index of its parent
+
     public:
 
         ///////////////////////////////////////////////////////////////////////////
@@ -900,6 +1393,7 @@ namespace rapidxml
         //! \param type Type of node to construct.
         xml_node(node_type type)
             : m_type(type)
+            , m_indexed(false)
             , m_first_node(0)
             , m_first_attribute(0)
         {
@@ -948,6 +1442,62 @@ namespace rapidxml
                 return m_first_node;
         }
 
+        //! Gets first child node whose name is an interned name.
+        //! Names are interned when the document is parsed with rapidxml::parse_intern_names flag.
+        //! Only one pointer is compared per child; nodes whose name was set after parsing never match.
+        //! \param atom Interned name returned by xml_document::atom(), or 0 to find nothing
+        //! \return Pointer to found child, or 0 if not found.
+        xml_node<Ch> *first_node_atom(const Ch *atom) const
+        {
+            if (atom)
+                for (xml_node<Ch> *child = m_first_node; child; child = child->m_next_sibling)
+                    if (child->m_name == atom)
+                        return child;
+            return 0;
+        }
+
+        //! Gets first child node with the specified name, through the child index of this node.
+        //! The index maps each child name to its first child. It is built in the memory pool of the document
+        //! on the first call to this function or child_count(), and held by the document, so later lookups
+        //! take time proportional to the depth of this node rather than to the number of its children.
+        //! It is kept up to date by append_node() and prepend_node(), and dropped by other changes to the children,
+        //! including renaming one of them, to be rebuilt by the next query. Each rebuild takes new memory from the pool,
+        //! so queries that build an index must not run concurrently with other queries on the same document.
+        //! Although const, this function and child_count() may thus allocate from the document's memory pool.
+        //! Nodes that do not belong to a document have no index and are searched with first_node().
+        //! \param name Name of child to find; this string doesn't have to be zero-terminated if name_size is non-zero
+        //! \param name_size Size of name, in characters, or 0 to have size calculated automatically from string
+        //! \return Pointer to found child, or 0 if not found.
+        xml_node<Ch> *first_node_indexed(const Ch *name, std::size_t name_size = 0) const
+        {
+            assert(name);
+            if (name_size == 0)
+                name_size = internal::measure(name);
+            if (internal::child_index<Ch> *index = indexed())
+                return *index->find(name, name_size);
+            return first_node(name, name_size);
+        }
+
+        //! Gets number of child nodes, through the child index of this node (see first_node_indexed()).
+        //! Although const, this builds the index if it is not current, which allocates from the document's memory pool.
+        //! \return Number of children of node.
+        std::size_t child_count() const
+        {
+            if (internal::child_index<Ch> *index = indexed())
+                return index->count;
+            std::size_t count = 0;
+            for (xml_node<Ch> *child = m_first_node; child; child = child->m_next_sibling)
+                ++count;
+            return count;
+        }
+
+        //! Tests if the child index of this node is built and current (see first_node_indexed()).
+        //! \return True if child_count() and first_node_indexed() do not walk the children.
+        bool has_child_index() const
+        {
+            return m_indexed;
+        }
+
         //! Gets last child node, optionally matching node name. 
         //! Behaviour is undefined if node has no children.
         //! Use first_node() to test if node has children.
@@ -1017,6 +1567,21 @@ namespace rapidxml
                 return m_next_sibling;
         }
 
+        //! Gets next sibling node whose name is an interned name.
+        //! Behaviour is undefined if node has no parent.
+        //! See first_node_atom().
+        //! \param atom Interned name returned by xml_document::atom(), or 0 to find nothing
+        //! \return Pointer to found sibling, or 0 if not found.
+        xml_node<Ch> *next_sibling_atom(const Ch *atom) const
+        {
+            assert(this->m_parent);     // Cannot query for siblings if node has no parent
+            if (atom)
+                for (xml_node<Ch> *sibling = m_next_sibling; sibling; sibling = sibling->m_next_sibling)
+                    if (sibling->m_name == atom)
+                        return sibling;
+            return 0;
+        }
+
         //! Gets first attribute of node, optionally matching attribute name.
         //! \param name Name of attribute to find, or 0 to return first attribute regardless of its name; this string doesn't have to be zero-terminated if name_size is non-zero
         //! \param name_size Size of name, in characters, or 0 to have size calculated automatically from string
@@ -1089,6 +1654,8 @@ namespace rapidxml
             m_first_node = child;
             child->m_parent = this;
             child->m_prev_sibling = 0;
+            if (m_indexed)
+                index_child(child, true);
         }
 
         //! Appends a new child node. 
@@ -1110,6 +1677,8 @@ namespace rapidxml
             m_last_node = child;
             child->m_parent = this;
             child->m_next_sibling = 0;
+            if (m_indexed)
+                index_child(child, false);
         }
 
         //! Inserts a new child node at specified place inside the node. 
@@ -1131,6 +1700,7 @@ namespace rapidxml
                 where->m_prev_sibling->m_next_sibling = child;
                 where->m_prev_sibling = child;
                 child->m_parent = this;
+                m_indexed = false;
             }
         }
 
@@ -1147,6 +1717,7 @@ namespace rapidxml
             else
                 m_last_node = 0;
             child->m_parent = 0;
+            m_indexed = false;
         }
 
         //! Removes last child of the node. 
@@ -1164,6 +1735,7 @@ namespace rapidxml
             else
                 m_first_node = 0;
             child->m_parent = 0;
+            m_indexed = false;
         }
 
         //! Removes specified child from the node
@@ -1181,6 +1753,7 @@ namespace rapidxml
                 where->m_prev_sibling->m_next_sibling = where->m_next_sibling;
                 where->m_next_sibling->m_prev_sibling = where->m_prev_sibling;
                 where->m_parent = 0;
+                m_indexed = false;
             }
         }
 
@@ -1190,6 +1763,7 @@ namespace rapidxml
             for (xml_node<Ch> *node = first_node(); node; node = node->m_next_sibling)
                 node->m_parent = 0;
             m_first_node = 0;
+            m_indexed = false;
         }
 
         //! Prepends a new attribute to the node.
@@ -1321,6 +1895,35 @@ namespace rapidxml
         // No copying
         xml_node(const xml_node &);
         void operator =(const xml_node &);
+
+        ///////////////////////////////////////////////////////////////////////////
+        // Child index
+
+        // Returns the child index, building it first if needed, or 0 if node does not belong to a document
+        internal::child_index<Ch> *indexed() const
+        {
+            xml_document<Ch> *document = this->document();
+            if (!document)
+                return 0;
+            internal::child_index<Ch> *&index = document->child_index_of(this);
+            if (!m_indexed || !index)
+            {
+                index = internal::child_index<Ch>::build(document, m_first_node);
+                m_indexed = true;
+            }
+            return index;
+        }
+
+        // Records a new child in the index, if the document still holds it
+        void index_child(xml_node<Ch> *child, bool first)
+        {
+            xml_document<Ch> *document = this->document();
+            internal::child_index<Ch> *index = document ? document->child_index_of(this) : 0;
+            if (index)
+                index->add(child, first);
+            else
+                m_indexed = false;
+        }
     
         ///////////////////////////////////////////////////////////////////////////
         // Data members
@@ -1333,8 +1936,10 @@ namespace rapidxml
         // 1. first_node and first_attribute contain valid pointers, or 0 if node has no children/attributes respectively
         // 2. last_node and last_attribute are valid only if node has at least one child/attribute respectively, otherwise they contain garbage
         // 3. prev_sibling and next_sibling are valid only if node has a parent, otherwise they contain garbage
+        // m_indexed fills the padding after m_type, so that nodes do not grow for the sake of the optional child index.
 
         node_type m_type;                       // Type of node; always valid
+        mutable bool m_indexed;                 // True if the child index held by the document is up to date; always valid
         xml_node<Ch> *m_first_node;             // Pointer to first child node, or 0 if none; always valid
         xml_node<Ch> *m_last_node;              // Pointer to last child node, or 0 if none; this value is only valid if m_first_node is non-zero
         xml_attribute<Ch> *m_first_attribute;   // Pointer to first attribute of node, or 0 if none; always valid
@@ -1357,12 +1962,20 @@ namespace rapidxml
     template<class Ch = char>
     class xml_document: public xml_node<Ch>, public memory_pool<Ch>
     {
+
+        friend class xml_node<Ch>;
     
     public:
 
         //! Constructs empty XML document
         xml_document()
             : xml_node<Ch>(node_document)
+            , m_atoms(0)
+            , m_atom_capacity(0)
+            , m_atom_count(0)
+            , m_indices(0)
+            , m_index_capacity(0)
+            , m_index_count(0)
         {
         }
 
@@ -1376,6 +1989,7 @@ namespace rapidxml
         //! <br><br>
         //! Document can be parsed into multiple times. 
         //! Each new call to parse removes previous nodes and attributes (if any), but does not clear memory pool.
+        //! Call reset() first to reuse the memory of the previous parse.
         //! \param text XML data to parse; pointer is non-const to denote fact that this data may be modified by the parser.
         template<int Flags>
         void parse(Ch *text)
@@ -1416,35 +2030,236 @@ namespace rapidxml
         {
             this->remove_all_nodes();
             this->remove_all_attributes();
+            clear_atoms();
+            clear_indices();
             memory_pool<Ch>::clear();
         }
-        
-    private:
 
-        ///////////////////////////////////////////////////////////////////////
-        // Internal character utility functions
-        
-        // Detect whitespace character
-        struct whitespace_pred
+        //! Clears the document by deleting all nodes, and rewinds the memory pool without freeing it.
+        //! All nodes owned by document pool are destroyed, but the memory they occupied is reused by the next parse.
+        void reset()
         {
-            static unsigned char test(Ch ch)
-            {
-                return internal::lookup_tables<0>::lookup_whitespace[static_cast<unsigned char>(ch)];
-            }
-        };
+            this->remove_all_nodes();
+            this->remove_all_attributes();
+            clear_atoms();
+            clear_indices();
+            memory_pool<Ch>::reset();
+        }
 
-        // Detect node name character
-        struct node_name_pred
+        //! Gets the interned copy of an element name, to pass to xml_node::first_node_atom() and xml_node::next_sibling_atom().
+        //! Names are interned when the document is parsed with rapidxml::parse_intern_names flag,
+        //! and stay interned until the document is cleared or reset.
+        //! \param name Name to look up; this string doesn't have to be zero-terminated if name_size is non-zero
+        //! \param name_size Size of name, in characters, or 0 to have size calculated automatically from string
+        //! \return Interned name, or 0 if no element with this name has been parsed into the document.
+        const Ch *atom(const Ch *name, std::size_t name_size = 0) const
         {
-            static unsigned char test(Ch ch)
-            {
-                return internal::lookup_tables<0>::lookup_node_name[static_cast<unsigned char>(ch)];
-            }
-        };
+            assert(name);
+            if (name_size == 0)
+                name_size = internal::measure(name);
+            return m_atoms ? find_atom(name, name_size)->name : 0;
+        }
 
-        // Detect attribute name character
+        //! Parses zero-terminated XML string according to given flags, reporting its structure to a handler instead of building DOM.
+        //! No nodes, attributes or strings are allocated, so neither this document nor its memory_pool is needed;
+        //! the function is static and can be called as <code>xml_document<>::parse_sax<Flags>(text, handler)</code>.
+        //! <br><br>
+        //! Handler must provide the following member functions, all receiving pointers into the source text:
+        //! <br><code>
+        //! <br>void start_element(Ch *name, std::size_t name_size);
+        //! <br>void attribute(Ch *name, std::size_t name_size, Ch *value, std::size_t value_size);
+        //! <br>void text(Ch *value, std::size_t value_size);
+        //! <br>void end_element(Ch *name, std::size_t name_size);
+        //! </code><br>
+        //! text() is called for data and CDATA sections. Comments, declarations, DOCTYPE and PIs are skipped.
+        //! Strings passed to the handler are never zero terminated; use the sizes to determine where they end.
+        //! Source text is still modified when entities are translated or whitespace is normalized,
+        //! unless rapidxml::parse_no_entity_translation flag is used and whitespace normalization is disabled.
+        //! Handler may throw to abort parsing.
+        //! In case of error, rapidxml::parse_error exception will be thrown.
+        //! \param text XML data to parse; pointer is non-const to denote fact that this data may be modified by the parser.
+        //! \param handler Object receiving parse events.
+        template<int Flags, class Handler>
+        static void parse_sax(Ch *text, Handler &handler)
+        {
+            assert(text);
+
+            // Parse BOM, if any
+            if (static_cast<unsigned char>(text[0]) == 0xEF &&
+                static_cast<unsigned char>(text[1]) == 0xBB &&
+                static_cast<unsigned char>(text[2]) == 0xBF)
+            {
+                text += 3;
+            }
+
+            // Parse children
+            while (1)
+            {
+                // Skip whitespace before node
+                skip<whitespace_pred, Flags>(text);
+                if (*text == 0)
+                    break;
+
+                if (*text == Ch('<'))
+                {
+                    ++text;     // Skip '<'
+                    parse_sax_node<Flags>(text, handler);
+                }
+                else
+                    RAPIDXML_PARSE_ERROR("expected <", text);
+            }
+        }
+
+    private:
+
+        ///////////////////////////////////////////////////////////////////////
+        // Atom table
+
+        // Slot of the open addressing hash table of interned names
+        struct atom_entry
+        {
+            Ch *name;               // Interned name, or 0 if slot is empty
+            std::size_t size;       // Length of name
+        };
+
+        // Returns the slot holding name, or the empty slot where it belongs
+        atom_entry *find_atom(const Ch *name, std::size_t size) const
+        {
+            std::size_t mask = m_atom_capacity - 1;
+            for (std::size_t i = internal::hash(name, size) & mask; ; i = (i + 1) & mask)
+            {
+                atom_entry *entry = m_atoms + i;
+                if (!entry->name || internal::compare(entry->name, entry->size, name, size, true))
+                    return entry;
+            }
+        }
+
+        // Returns the interned copy of name, adding it if needed
+        Ch *intern(const Ch *name, std::size_t size)
+        {
+            if (2 * (m_atom_count + 1) > m_atom_capacity)
+                grow_atoms();
+            atom_entry *entry = find_atom(name, size);
+            if (!entry->name)
+            {
+                Ch *copy = this->allocate_string(name, size + 1);
+                copy[size] = Ch('\0');
+                entry->name = copy;
+                entry->size = size;
+                ++m_atom_count;
+            }
+            return entry->name;
+        }
+
+        // Doubles the table; the old one is left in the memory pool
+        void grow_atoms()
+        {
+            atom_entry *old_atoms = m_atoms;
+            std::size_t old_capacity = m_atom_capacity;
+            m_atom_capacity = old_capacity ? 2 * old_capacity : 64;
+            // The pool only hands out strings; they are aligned to RAPIDXML_ALIGNMENT, which suits atom_entry
+            std::size_t chars = (m_atom_capacity * sizeof(atom_entry) + sizeof(Ch) - 1) / sizeof(Ch);
+            m_atoms = reinterpret_cast<atom_entry *>(this->allocate_string(0, chars));
+            for (std::size_t i = 0; i < m_atom_capacity; ++i)
+                m_atoms[i].name = 0;
+            for (std::size_t i = 0; i < old_capacity; ++i)
+                if (old_atoms[i].name)
+                    *find_atom(old_atoms[i].name, old_atoms[i].size) = old_atoms[i];
+        }
+
+        void clear_atoms()
+        {
+            m_atoms = 0;
+            m_atom_capacity = 0;
+            m_atom_count = 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Child indices
+
+        // Slot of the open addressing hash table of child indices, keyed by node
+        struct index_entry
+        {
+            const xml_node<Ch> *node;               // Indexed node, or 0 if slot is empty
+            internal::child_index<Ch> *index;       // Its child index, or 0 if not built yet
+        };
+
+        // Returns the slot holding the child index of node, adding an empty one if needed.
+        // An index is only current while the node's m_indexed flag is set.
+        internal::child_index<Ch> *&child_index_of(const xml_node<Ch> *node)
+        {
+            if (2 * (m_index_count + 1) > m_index_capacity)
+                grow_indices();
+            index_entry *entry = find_index(node);
+            if (!entry->node)
+            {
+                entry->node = node;
+                entry->index = 0;
+                ++m_index_count;
+            }
+            return entry->index;
+        }
+
+        // Returns the slot of node, or the empty slot where it belongs
+        index_entry *find_index(const xml_node<Ch> *node) const
+        {
+            std::size_t mask = m_index_capacity - 1;
+            for (std::size_t i = internal::hash(reinterpret_cast<const char *>(&node), sizeof(node)) & mask; ; i = (i + 1) & mask)
+            {
+                index_entry *entry = m_indices + i;
+                if (!entry->node || entry->node == node)
+                    return entry;
+            }
+        }
+
+        // Doubles the table; the old one is left in the memory pool
+        void grow_indices()
+        {
+            index_entry *old_indices = m_indices;
+            std::size_t old_capacity = m_index_capacity;
+            m_index_capacity = old_capacity ? 2 * old_capacity : 16;
+            m_indices = internal::child_index<Ch>::template allocate<index_entry>(this, m_index_capacity);
+            for (std::size_t i = 0; i < m_index_capacity; ++i)
+                m_indices[i].node = 0;
+            for (std::size_t i = 0; i < old_capacity; ++i)
+                if (old_indices[i].node)
+                    *find_index(old_indices[i].node) = old_indices[i];
+        }
+
+        void clear_indices()
+        {
+            m_indices = 0;
+            m_index_capacity = 0;
+            m_index_count = 0;
+        }
+
+        ///////////////////////////////////////////////////////////////////////
+        // Internal character utility functions
+        
+        // Detect whitespace character
+        struct whitespace_pred
+        {
+            typedef internal::simd_set<true, ' ', '\t', '\n', '\r'> simd;
+            static unsigned char test(Ch ch)
+            {
+                return internal::lookup_tables<0>::lookup_whitespace[static_cast<unsigned char>(ch)];
+            }
+        };
+
+        // Detect node name character
+        struct node_name_pred
+        {
+            typedef internal::simd_set<false, '\0', ' ', '\t', '\n', '\r', '/', '>', '?'> simd;
+            static unsigned char test(Ch ch)
+            {
+                return internal::lookup_tables<0>::lookup_node_name[static_cast<unsigned char>(ch)];
+            }
+        };
+
+        // Detect attribute name character
         struct attribute_name_pred
         {
+            typedef internal::simd_set<false, '\0', ' ', '\t', '\n', '\r', '!', '/', '<', '=', '>', '?'> simd;
             static unsigned char test(Ch ch)
             {
                 return internal::lookup_tables<0>::lookup_attribute_name[static_cast<unsigned char>(ch)];
@@ -1454,6 +2269,7 @@ namespace rapidxml
         // Detect text character (PCDATA)
         struct text_pred
         {
+            typedef internal::simd_set<false, '\0', '<'> simd;
             static unsigned char test(Ch ch)
             {
                 return internal::lookup_tables<0>::lookup_text[static_cast<unsigned char>(ch)];
@@ -1463,6 +2279,7 @@ namespace rapidxml
         // Detect text character (PCDATA) that does not require processing
         struct text_pure_no_ws_pred
         {
+            typedef internal::simd_set<false, '\0', '&', '<'> simd;
             static unsigned char test(Ch ch)
             {
                 return internal::lookup_tables<0>::lookup_text_pure_no_ws[static_cast<unsigned char>(ch)];
@@ -1472,6 +2289,7 @@ namespace rapidxml
         // Detect text character (PCDATA) that does not require processing
         struct text_pure_with_ws_pred
         {
+            typedef internal::simd_set<false, '\0', ' ', '\t', '\n', '\r', '&', '<'> simd;
             static unsigned char test(Ch ch)
             {
                 return internal::lookup_tables<0>::lookup_text_pure_with_ws[static_cast<unsigned char>(ch)];
@@ -1482,6 +2300,7 @@ namespace rapidxml
         template<Ch Quote>
         struct attribute_value_pred
         {
+            typedef internal::simd_set<false, '\0', static_cast<char>(Quote)> simd;
             static unsigned char test(Ch ch)
             {
                 if (Quote == Ch('\''))
@@ -1496,6 +2315,7 @@ namespace rapidxml
         template<Ch Quote>
         struct attribute_value_pure_pred
         {
+            typedef internal::simd_set<false, '\0', '&', static_cast<char>(Quote)> simd;
             static unsigned char test(Ch ch)
             {
                 if (Quote == Ch('\''))
@@ -1556,6 +2376,12 @@ namespace rapidxml
         // Skip characters until predicate evaluates to true
         template<class StopPred, int Flags>
         static void skip(Ch *&text)
+        {
+            skip<StopPred, Flags>(text, typename StopPred::simd());
+        }
+
+        template<class StopPred, int Flags>
+        static void skip(Ch *&text, internal::no_simd)
         {
             Ch *tmp = text;
             while (StopPred::test(*tmp))
@@ -1563,6 +2389,32 @@ namespace rapidxml
             text = tmp;
         }
 
+        // Vectorized skip for predicates that have a simd_set
+        template<class StopPred, int Flags, bool Skip, char... Chars>
+        static void skip(Ch *&text, internal::simd_set<Skip, Chars...> set)
+        {
+#if defined(RAPIDXML_SIMD)
+            if (sizeof(Ch) == 1)
+            {
+                // Most runs (indentation, names, numbers) are short and end within a few characters,
+                // where the lookup table is cheaper than setting up vector compares
+                Ch *tmp = text;
+                for (int i = 0; i < RAPIDXML_SIMD_MIN_RUN; ++i, ++tmp)
+                    if (!StopPred::test(*tmp))
+                    {
+                        text = tmp;
+                        return;
+                    }
+                typedef internal::simd_set<Skip, Chars...> set_type;
+                const char *end = internal::simd_skip<set_type>::skip(reinterpret_cast<const char *>(tmp));
+                text = reinterpret_cast<Ch *>(const_cast<char *>(end));
+                return;
+            }
+#endif
+            (void)set;
+            skip<StopPred, Flags>(text, internal::no_simd());
+        }
+
         // Skip characters until predicate evaluates to true while doing the following:
         // - replacing XML character entity references with proper characters (&apos; &amp; &quot; &lt; &gt; &#...;)
         // - condensing whitespace sequences to single space character
@@ -2044,7 +2896,10 @@ namespace rapidxml
             skip<node_name_pred, Flags>(text);
             if (text == name)
                 RAPIDXML_PARSE_ERROR("expected element name", text);
-            element->name(name, text - name);
+            if (Flags & parse_intern_names)
+                element->name(intern(name, text - name), text - name);
+            else
+                element->name(name, text - name);
             
             // Skip whitespace between element name and attributes or >
             skip<whitespace_pred, Flags>(text);
@@ -2068,8 +2923,8 @@ namespace rapidxml
             else
                 RAPIDXML_PARSE_ERROR("expected >", text);
 
-            // Place zero terminator after name
-            if (!(Flags & parse_no_string_terminators))
+            // Place zero terminator after name; interned names already have one
+            if (!(Flags & parse_no_string_terminators) && !(Flags & parse_intern_names))
                 element->name()[element->name_size()] = Ch('\0');
 
             // Return parsed element
@@ -2297,6 +3152,274 @@ namespace rapidxml
             }
         }
 
+        ///////////////////////////////////////////////////////////////////////
+        // Internal event parsing functions
+        // These mirror the DOM parsing functions above, but report to a handler instead of allocating nodes
+
+        // Skip text until terminator is found, failing at end of data
+        static void skip_past(Ch *&text, Ch c0, Ch c1, Ch c2)
+        {
+            while (text[0] != c0 || (c1 && text[1] != c1) || (c2 && text[2] != c2))
+            {
+                if (!text[0])
+                    RAPIDXML_PARSE_ERROR("unexpected end of data", text);
+                ++text;
+            }
+            text += c2 ? 3 : c1 ? 2 : 1;
+        }
+
+        // Determine node type, and parse it
+        template<int Flags, class Handler>
+        static void parse_sax_node(Ch *&text, Handler &handler)
+        {
+            switch (text[0])
+            {
+
+            // <...
+            default:
+                parse_sax_element<Flags>(text, handler);
+                return;
+
+            // <?... - declaration or PI, skip to '?>'
+            case Ch('?'):
+                ++text;     // Skip ?
+                skip_past(text, Ch('?'), Ch('>'), 0);
+                return;
+
+            // <!...
+            case Ch('!'):
+                if (text[1] == Ch('-') && text[2] == Ch('-'))
+                {
+                    // '<!--' - xml comment
+                    text += 3;     // Skip '!--'
+                    skip_past(text, Ch('-'), Ch('-'), Ch('>'));
+                    return;
+                }
+                if (text[1] == Ch('[') && text[2] == Ch('C') && text[3] == Ch('D') && text[4] == Ch('A') &&
+                    text[5] == Ch('T') && text[6] == Ch('A') && text[7] == Ch('['))
+                {
+                    // '<![CDATA[' - cdata
+                    text += 8;     // Skip '![CDATA['
+                    Ch *value = text;
+                    skip_past(text, Ch(']'), Ch(']'), Ch('>'));
+                    if (!(Flags & parse_no_data_nodes))
+                        handler.text(value, text - 3 - value);
+                    return;
+                }
+
+                // DOCTYPE and other <! nodes; scan for matching ']' using naive algorithm with depth
+                ++text;     // Skip !
+                while (*text != Ch('>'))
+                {
+                    if (*text == Ch('['))
+                    {
+                        ++text;     // Skip '['
+                        int depth = 1;
+                        while (depth > 0)
+                        {
+                            switch (*text)
+                            {
+                                case Ch('['): ++depth; break;
+                                case Ch(']'): --depth; break;
+                                case 0: RAPIDXML_PARSE_ERROR("unexpected end of data", text);
+                            }
+                            ++text;
+                        }
+                    }
+                    else if (*text == Ch('\0'))
+                    {
+                        RAPIDXML_PARSE_ERROR("unexpected end of data", text);
+                    }
+                    else
+                        ++text;
+                }
+                ++text;     // Skip '>'
+                return;
+
+            }
+        }
+
+        // Parse element node
+        template<int Flags, class Handler>
+        static void parse_sax_element(Ch *&text, Handler &handler)
+        {
+            // Extract element name
+            Ch *name = text;
+            skip<node_name_pred, Flags>(text);
+            if (text == name)
+                RAPIDXML_PARSE_ERROR("expected element name", text);
+            std::size_t name_size = text - name;
+            handler.start_element(name, name_size);
+
+            // Skip whitespace between element name and attributes or >
+            skip<whitespace_pred, Flags>(text);
+
+            // Parse attributes, if any
+            parse_sax_attributes<Flags>(text, handler);
+
+            // Determine ending type
+            if (*text == Ch('>'))
+            {
+                ++text;
+                parse_sax_node_contents<Flags>(text, name, name_size, handler);
+            }
+            else if (*text == Ch('/'))
+            {
+                ++text;
+                if (*text != Ch('>'))
+                    RAPIDXML_PARSE_ERROR("expected >", text);
+                ++text;
+                handler.end_element(name, name_size);
+            }
+            else
+                RAPIDXML_PARSE_ERROR("expected >", text);
+        }
+
+        // Parse contents of the element - children, data etc.
+        template<int Flags, class Handler>
+        static void parse_sax_node_contents(Ch *&text, Ch *name, std::size_t name_size, Handler &handler)
+        {
+            // For all children and text
+            while (1)
+            {
+                // Skip whitespace between > and node contents
+                Ch *contents_start = text;      // Store start of node contents before whitespace is skipped
+                skip<whitespace_pred, Flags>(text);
+
+                switch (*text)
+                {
+
+                // Node closing or child node
+                case Ch('<'):
+                    if (text[1] == Ch('/'))
+                    {
+                        // Node closing
+                        text += 2;      // Skip '</'
+                        Ch *closing_name = text;
+                        skip<node_name_pred, Flags>(text);
+                        if (Flags & parse_validate_closing_tags)
+                            if (!internal::compare(name, name_size, closing_name, text - closing_name, true))
+                                RAPIDXML_PARSE_ERROR("invalid closing tag name", text);
+                        // Skip remaining whitespace after node name
+                        skip<whitespace_pred, Flags>(text);
+                        if (*text != Ch('>'))
+                            RAPIDXML_PARSE_ERROR("expected >", text);
+                        ++text;     // Skip '>'
+                        handler.end_element(name, name_size);
+                        return;     // Node closed, finished parsing contents
+                    }
+                    else
+                    {
+                        // Child node
+                        ++text;     // Skip '<'
+                        parse_sax_node<Flags>(text, handler);
+                    }
+                    break;
+
+                // End of data - error
+                case Ch('\0'):
+                    RAPIDXML_PARSE_ERROR("unexpected end of data", text);
+
+                // Data node
+                default:
+                    parse_sax_data<Flags>(text, contents_start, handler);
+                    break;
+
+                }
+            }
+        }
+
+        // Parse data and report it to the handler
+        template<int Flags, class Handler>
+        static void parse_sax_data(Ch *&text, Ch *contents_start, Handler &handler)
+        {
+            // Backup to contents start if whitespace trimming is disabled
+            if (!(Flags & parse_trim_whitespace))
+                text = contents_start;
+
+            // Skip until end of data
+            Ch *value = text, *end;
+            if (Flags & parse_normalize_whitespace)
+                end = skip_and_expand_character_refs<text_pred, text_pure_with_ws_pred, Flags>(text);
+            else
+                end = skip_and_expand_character_refs<text_pred, text_pure_no_ws_pred, Flags>(text);
+
+            // Trim trailing whitespace if flag is set; leading was already trimmed by whitespace skip after >
+            if (Flags & parse_trim_whitespace)
+            {
+                if (Flags & parse_normalize_whitespace)
+                {
+                    if (*(end - 1) == Ch(' '))
+                        --end;
+                }
+                else
+                {
+                    while (whitespace_pred::test(*(end - 1)))
+                        --end;
+                }
+            }
+
+            if (!(Flags & parse_no_data_nodes))
+                handler.text(value, end - value);
+        }
+
+        // Parse XML attributes of the element
+        template<int Flags, class Handler>
+        static void parse_sax_attributes(Ch *&text, Handler &handler)
+        {
+            // For all attributes
+            while (attribute_name_pred::test(*text))
+            {
+                // Extract attribute name
+                Ch *name = text;
+                ++text;     // Skip first character of attribute name
+                skip<attribute_name_pred, Flags>(text);
+                std::size_t name_size = text - name;
+
+                // Skip whitespace after attribute name
+                skip<whitespace_pred, Flags>(text);
+
+                // Skip =
+                if (*text != Ch('='))
+                    RAPIDXML_PARSE_ERROR("expected =", text);
+                ++text;
+
+                // Skip whitespace after =
+                skip<whitespace_pred, Flags>(text);
+
+                // Skip quote and remember if it was ' or "
+                Ch quote = *text;
+                if (quote != Ch('\'') && quote != Ch('"'))
+                    RAPIDXML_PARSE_ERROR("expected ' or \"", text);
+                ++text;
+
+                // Extract attribute value and expand char refs in it
+                Ch *value = text, *end;
+                const int AttFlags = Flags & ~parse_normalize_whitespace;   // No whitespace normalization in attributes
+                if (quote == Ch('\''))
+                    end = skip_and_expand_character_refs<attribute_value_pred<Ch('\'')>, attribute_value_pure_pred<Ch('\'')>, AttFlags>(text);
+                else
+                    end = skip_and_expand_character_refs<attribute_value_pred<Ch('"')>, attribute_value_pure_pred<Ch('"')>, AttFlags>(text);
+
+                // Make sure that end quote is present
+                if (*text != quote)
+                    RAPIDXML_PARSE_ERROR("expected ' or \"", text);
+                ++text;     // Skip quote
+
+                handler.attribute(name, name_size, value, end - value);
+
+                // Skip whitespace after attribute value
+                skip<whitespace_pred, Flags>(text);
+            }
+        }
+
+        atom_entry *m_atoms;                // Table of interned names, or 0 if none yet
+        std::size_t m_atom_capacity;        // Number of slots in table, a power of 2
+        std::size_t m_atom_count;           // Number of interned names
+        index_entry *m_indices;             // Table of child indices, or 0 if none yet
+        std::size_t m_index_capacity;       // Number of slots in table, a power of 2
+        std::size_t m_index_count;          // Number of indexed nodes
+
     };
 
     //! \cond internal
@@ -0,0 +1,277 @@
+#ifndef RAPIDXML_COMPACT_HPP_INCLUDED
+#define RAPIDXML_COMPACT_HPP_INCLUDED
+
+//! \file rapidxml_compact.hpp This file contains compact_document, an index-based alternative to the
+//! pointer-based DOM of rapidxml.hpp for documents made of very many small elements.
+
+#include "rapidxml.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace rapidxml
+{
+
+    //! Element of a compact_document.
+    //! Names and values are offsets and lengths into the source text, links are indices into the node array.
+    //! At 28 bytes it is about a quarter of an xml_node on 64-bit targets.
+    struct compact_node
+    {
+        std::uint32_t name;                 //!< Offset of element name in source text
+        std::uint32_t name_size;            //!< Length of element name
+        std::uint32_t value;                //!< Offset of element value (its first data or CDATA section) in source text
+        std::uint32_t value_size;           //!< Length of element value, 0 if there is none
+        std::uint32_t parent;               //!< Index of parent element, or compact_document::npos for top level elements
+        std::uint32_t next_sibling;         //!< Index of next sibling element, or compact_document::npos
+        std::uint32_t first_attribute;      //!< Index of first attribute; attributes run up to the next node's first_attribute
+    };
+
+    //! Attribute of a compact_document element.
+    struct compact_attribute
+    {
+        std::uint32_t name;                 //!< Offset of attribute name in source text
+        std::uint32_t name_size;            //!< Length of attribute name
+        std::uint32_t value;                //!< Offset of attribute value in source text
+        std::uint32_t value_size;           //!< Length of attribute value
+    };
+
+    //! Compact DOM: elements and attributes of a document held in two arrays, in document order.
+    //! <br><br>
+    //! The children of an element directly follow it, so a linear walk over nodes() is a depth first traversal,
+    //! and following first_node()/next_sibling() only ever moves forward through contiguous memory.
+    //! Only elements are stored; comments, declarations, DOCTYPE and PIs are skipped,
+    //! and data and CDATA sections only provide the value of their element, as in the default xml_document.
+    //! <br><br>
+    //! The document is built with xml_document::parse_sax(), so names and values are not zero terminated;
+    //! use the sizes to determine where they end.
+    //! The source text must persist for the lifetime of the document and be smaller than 4 GB.
+    //! Arrays keep their capacity when the document is parsed again or cleared.
+    //! \param Ch Character type to use.
+    template<class Ch = char>
+    class compact_document
+    {
+
+    public:
+
+        //! Index of a node or attribute.
+        typedef std::uint32_t index;
+
+        //! Index denoting no node.
+        static const index npos = ~index(0);
+
+        //! Constructs empty document.
+        compact_document()
+            : m_text(0)
+        {
+        }
+
+        //! Parses zero-terminated XML string according to given flags, replacing the current contents.
+        //! Source text is modified as by xml_document::parse_sax().
+        //! In case of error, rapidxml::parse_error exception will be thrown.
+        //! \param text XML data to parse; pointer is non-const to denote fact that this data may be modified by the parser.
+        template<int Flags>
+        void parse(Ch *text)
+        {
+            clear();
+            m_text = text;
+            builder handler(*this);
+            xml_document<Ch>::template parse_sax<Flags>(text, handler);
+        }
+
+        //! Removes all nodes and attributes.
+        void clear()
+        {
+            m_nodes.clear();
+            m_attributes.clear();
+            m_text = 0;
+        }
+
+        //! Makes room for the given number of elements, so that parsing a document with no more than that
+        //! never reallocates the node array. Capacity is kept across parse() and clear().
+        //! \param nodes Number of elements, see count_plot() for a cheap upper bound.
+        void reserve(std::size_t nodes)
+        {
+            m_nodes.reserve(nodes);
+        }
+
+        //! Gets all elements in document order.
+        const std::vector<compact_node> &nodes() const
+        {
+            return m_nodes;
+        }
+
+        //! Gets all attributes in document order.
+        const std::vector<compact_attribute> &attributes() const
+        {
+            return m_attributes;
+        }
+
+        //! Gets first top level element, or npos if the document is empty.
+        index first_node() const
+        {
+            return m_nodes.empty() ? npos : 0;
+        }
+
+        //! Gets first child element of a node, or npos if it has none.
+        index first_node(index node) const
+        {
+            return node + 1 < m_nodes.size() && m_nodes[node + 1].parent == node ? node + 1 : npos;
+        }
+
+        //! Gets next sibling element of a node, or npos if it is the last one.
+        index next_sibling(index node) const
+        {
+            return m_nodes[node].next_sibling;
+        }
+
+        //! Gets parent element of a node, or npos for top level elements.
+        index parent(index node) const
+        {
+            return m_nodes[node].parent;
+        }
+
+        //! Gets name of a node. It is not zero terminated.
+        const Ch *name(index node) const
+        {
+            return m_text + m_nodes[node].name;
+        }
+
+        //! Gets size of name of a node.
+        std::size_t name_size(index node) const
+        {
+            return m_nodes[node].name_size;
+        }
+
+        //! Gets value of a node. It is not zero terminated.
+        const Ch *value(index node) const
+        {
+            return m_text + m_nodes[node].value;
+        }
+
+        //! Gets size of value of a node.
+        std::size_t value_size(index node) const
+        {
+            return m_nodes[node].value_size;
+        }
+
+        //! Gets index of first attribute of a node.
+        index first_attribute(index node) const
+        {
+            return m_nodes[node].first_attribute;
+        }
+
+        //! Gets index one past the last attribute of a node.
+        index attribute_end(index node) const
+        {
+            return node + 1 < m_nodes.size() ? m_nodes[node + 1].first_attribute : index(m_attributes.size());
+        }
+
+        //! Gets source text the document refers to.
+        const Ch *text() const
+        {
+            return m_text;
+        }
+
+    private:
+
+        // SAX handler appending elements and attributes
+        class builder
+        {
+
+        public:
+
+            builder(compact_document &document)
+                : m_document(document)
+                , m_current(npos)
+                , m_previous(npos)
+            {
+            }
+
+            void start_element(Ch *name, std::size_t name_size)
+            {
+                std::vector<compact_node> &nodes = m_document.m_nodes;
+                if (nodes.size() >= npos)
+                    error("too many elements", name);
+                index node = static_cast<index>(nodes.size());
+                if (m_previous != npos)
+                    nodes[m_previous].next_sibling = node;
+                compact_node n;
+                n.name = offset(name, name_size);
+                n.name_size = static_cast<std::uint32_t>(name_size);
+                n.value = 0;
+                n.value_size = 0;
+                n.parent = m_current;
+                n.next_sibling = npos;
+                n.first_attribute = static_cast<index>(m_document.m_attributes.size());
+                nodes.push_back(n);
+                m_current = node;
+                m_previous = npos;
+            }
+
+            void attribute(Ch *name, std::size_t name_size, Ch *value, std::size_t value_size)
+            {
+                compact_attribute a;
+                a.name = offset(name, name_size);
+                a.name_size = static_cast<std::uint32_t>(name_size);
+                a.value = offset(value, value_size);
+                a.value_size = static_cast<std::uint32_t>(value_size);
+                m_document.m_attributes.push_back(a);
+            }
+
+            void text(Ch *value, std::size_t value_size)
+            {
+                if (m_current == npos)
+                    return;
+                compact_node &node = m_document.m_nodes[m_current];
+                if (node.value == 0 && node.value_size == 0)
+                {
+                    node.value = offset(value, value_size);
+                    node.value_size = static_cast<std::uint32_t>(value_size);
+                }
+            }
+
+            void end_element(Ch *, std::size_t)
+            {
+                m_previous = m_current;
+                m_current = m_document.m_nodes[m_current].parent;
+            }
+
+        private:
+
+            // Reports an error the same way as the parser
+            static void error(const char *what, Ch *where)
+            {
+#if defined(RAPIDXML_NO_EXCEPTIONS)
+                parse_error_handler(what, where);
+                assert(0);
+#else
+                throw parse_error(what, where);
+#endif
+            }
+
+            // Offset of string in source text, checking that it fits in 32 bits
+            std::uint32_t offset(Ch *string, std::size_t size)
+            {
+                std::size_t result = string - m_document.m_text;
+                if (result + size >= npos)
+                    error("document too large", string);
+                return static_cast<std::uint32_t>(result);
+            }
+
+            compact_document &m_document;
+            index m_current;        // Innermost open element
+            index m_previous;       // Last closed child of m_current, whose next_sibling is still unknown
+        };
+
+        Ch *m_text;                                     // Source text
+        std::vector<compact_node> m_nodes;              // Elements in document order
+        std::vector<compact_attribute> m_attributes;    // Attributes in document order
+    };
+
+    //! \cond internal
+    template<class Ch>
+    const typename compact_document<Ch>::index compact_document<Ch>::npos;
+    //! \endcond
+
+}
+
+#endif
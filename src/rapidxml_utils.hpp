@@ -87,11 +87,14 @@ namespace rapidxml
 
     };
 
-    //! Counts children of node. Time complexity is O(n).
+    //! Counts children of node. Time complexity is O(depth of node) if it has a current child index
+    //! (see xml_node::first_node_indexed()), O(n) otherwise; no index is built.
     //! \return Number of children of node
     template<class Ch>
     inline std::size_t count_children(xml_node<Ch> *node)
     {
+        if (node->has_child_index())
+            return node->child_count();
         xml_node<Ch> *child = node->first_node();
         std::size_t count = 0;
         while (child)
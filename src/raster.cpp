@@ -0,0 +1,430 @@
+#include "raster.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Segments set up together by draw_lines().
+const std::size_t BATCH = 64;
+
+// cv::clipLine() for an image of width x height pixels: Cohen-Sutherland,
+// with OpenCV's rounding, so the clipped end points are the ones cv::line()
+// walks between.
+bool clip(long long width, long long height,
+          long long& x1, long long& y1, long long& x2, long long& y2) {
+    const long long right = width - 1;
+    const long long bottom = height - 1;
+    int c1 = (x1 < 0) + (x1 > right) * 2 + (y1 < 0) * 4 + (y1 > bottom) * 8;
+    int c2 = (x2 < 0) + (x2 > right) * 2 + (y2 < 0) * 4 + (y2 > bottom) * 8;
+
+    if ((c1 & c2) == 0 && (c1 | c2) != 0) {
+        long long a;
+        if (c1 & 12) {
+            a = c1 < 8 ? 0 : bottom;
+            x1 += static_cast<long long>(static_cast<double>(a - y1) * (x2 - x1) / (y2 - y1));
+            y1 = a;
+            c1 = (x1 < 0) + (x1 > right) * 2;
+        }
+        if (c2 & 12) {
+            a = c2 < 8 ? 0 : bottom;
+            x2 += static_cast<long long>(static_cast<double>(a - y2) * (x2 - x1) / (y2 - y1));
+            y2 = a;
+            c2 = (x2 < 0) + (x2 > right) * 2;
+        }
+        if ((c1 & c2) == 0 && (c1 | c2) != 0) {
+            if (c1) {
+                a = c1 == 1 ? 0 : right;
+                y1 += static_cast<long long>(static_cast<double>(a - x1) * (y2 - y1) / (x2 - x1));
+                x1 = a;
+                c1 = 0;
+            }
+            if (c2) {
+                a = c2 == 1 ? 0 : right;
+                y2 += static_cast<long long>(static_cast<double>(a - x2) * (y2 - y1) / (x2 - x1));
+                x2 = a;
+                c2 = 0;
+            }
+        }
+    }
+    return (c1 | c2) == 0;
+}
+
+template <int CHANNELS>
+void put(unsigned char* p, const Pixel& pixel) {
+    for (int c = 0; c < CHANNELS; ++c) {
+        p[c] = pixel.value[c];
+    }
+}
+
+// cv::LineIterator's 8-connected walk between two points of the image,
+// restricted to the raster's window.  The walk starts at the left end and
+// steps along the major axis every pixel and along the minor one whenever
+// the error term is negative.  After k steps the error term is
+//     major - 2 minor - 2 minor k + 2 major m,   m = minor steps taken,
+// and always lies in [-2 minor, 2 major - 2 minor), which fixes m, so the
+// steps before the window are skipped rather than walked.
+template <int CHANNELS>
+void walk(const Raster& raster, int xa, int ya, int xb, int yb, const Pixel& pixel) {
+    if (xb < xa) {
+        std::swap(xa, xb);
+        std::swap(ya, yb);
+    }
+    const int sy = yb < ya ? -1 : 1;
+    const int dx = xb - xa;
+    const int dy = (yb - ya) * sy;
+    const bool steep = dy > dx;
+    const long long major = steep ? dy : dx;
+    const long long minor = steep ? dx : dy;
+
+    // Steps with the major coordinate inside the window.
+    long long skip;
+    long long stop;
+    if (!steep) {
+        skip = raster.x0 - xa;
+        stop = raster.x1 - xa;
+    } else if (sy > 0) {
+        skip = raster.y0 - ya;
+        stop = raster.y1 - ya;
+    } else {
+        skip = ya - raster.y1;
+        stop = ya - raster.y0;
+    }
+    skip = std::max(skip, 0LL);
+    stop = std::min(stop, major);
+    if (skip > stop) {
+        return;
+    }
+    const long long m = skip ? (2 * minor * skip + major - 1) / (2 * major) : 0;
+    int err = static_cast<int>(major - 2 * minor - 2 * minor * skip + 2 * major * m);
+
+    int x = static_cast<int>(xa + (steep ? m : skip));
+    int y = static_cast<int>(ya + sy * (steep ? skip : m));
+    const int major_x = steep ? 0 : 1;
+    const int major_y = steep ? sy : 0;
+    const int minor_x = steep ? 1 : 0;
+    const int minor_y = steep ? 0 : sy;
+    const int plus = static_cast<int>(2 * major);
+    const int minus = static_cast<int>(2 * minor);
+    for (long long k = skip; k <= stop; ++k) {
+        if (x >= raster.x0 && x <= raster.x1 && y >= raster.y0 && y <= raster.y1) {
+            put<CHANNELS>(raster.pixel(x, y), pixel);
+        }
+        const int mask = err < 0 ? -1 : 0;
+        err += (plus & mask) - minus;
+        x += major_x + (minor_x & mask);
+        y += major_y + (minor_y & mask);
+    }
+}
+
+// Unit vectors of whole-degree directions, scaled by 2^30.  Every value is
+// derived from one quadrant of sines so that the table is exactly symmetric:
+// multiples of 45 degrees, the only whole-degree directions that pass
+// exactly through pixels, then give cross products of exactly 0.
+class Directions {
+public:
+    Directions() {
+        const double pi = std::acos(-1.0);
+        long long quadrant[91];
+        for (int a = 0; a <= 90; ++a) {
+            quadrant[a] = std::llround(std::ldexp(std::sin(a * pi / 180), 30));
+        }
+        for (int a = 0; a < 360; ++a) {
+            m_sin[a] = a <= 90 ? quadrant[a]
+                     : a <= 180 ? quadrant[180 - a]
+                     : a <= 270 ? -quadrant[a - 180]
+                     : -quadrant[360 - a];
+        }
+    }
+
+    long long sin(int degrees) const { return m_sin[degrees]; }
+    long long cos(int degrees) const { return m_sin[(degrees + 90) % 360]; }
+
+private:
+    long long m_sin[360];
+};
+
+const Directions& directions() {
+    static const Directions table;
+    return table;
+}
+
+// The part of a circle between two directions, start <= end < start + 360
+// with start in [0, 360).
+class Span {
+public:
+    Span(int start, int end)
+        : m_start(start)
+        , m_end(end)
+        , m_sx(directions().cos(start))
+        , m_sy(directions().sin(start))
+        , m_ex(directions().cos(end % 360))
+        , m_ey(directions().sin(end % 360))
+        {}
+
+    // Whether every direction in [lo, hi] degrees lies within the span.
+    bool covers(int lo, int hi) const {
+        return (m_start <= lo && hi <= m_end) || (m_start <= lo + 360 && hi + 360 <= m_end);
+    }
+
+    // Whether some direction in [lo, hi] degrees lies within the span.
+    bool meets(int lo, int hi) const {
+        return (lo <= m_end && m_start <= hi) || (lo + 360 <= m_end && m_start <= hi + 360);
+    }
+
+    // Whether the direction of offset (x, y) lies within the span.
+    bool contains(long long x, long long y) const {
+        const long long after_start = m_sx * y - m_sy * x;
+        const long long before_end = x * m_ey - y * m_ex;
+        if (m_end - m_start > 180) {
+            return after_start >= 0 || before_end >= 0;
+        }
+        return after_start >= 0 && before_end >= 0 &&
+               (m_end > m_start || m_sx * x + m_sy * y > 0);
+    }
+
+private:
+    int m_start;
+    int m_end;
+    long long m_sx;
+    long long m_sy;
+    long long m_ex;
+    long long m_ey;
+};
+
+// How octant k maps the walked offset (x, y), x >= y >= 0, which lies at 0
+// to 45 degrees: to (x * t[0] + y * t[1], x * t[2] + y * t[3]), at 45 k to
+// 45 (k + 1) degrees.
+const int OCTANTS[8][4] = {
+    { 1,  0,  0,  1},
+    { 0,  1,  1,  0},
+    { 0, -1,  1,  0},
+    {-1,  0,  0,  1},
+    {-1,  0,  0, -1},
+    { 0, -1, -1,  0},
+    { 0,  1, -1,  0},
+    { 1,  0,  0, -1},
+};
+
+template <int CHANNELS>
+void arc(const Raster& raster, int cx, int cy, int radius, const ArcSpan& angles,
+         const Pixel& pixel) {
+    const bool whole = angles.extent == 360;
+    const Span span(angles.start, angles.start + (whole ? 0 : angles.extent));
+
+    enum Mode { SKIP, ALL, TEST };
+    Mode mode[8];
+    for (int k = 0; k < 8; ++k) {
+        mode[k] = whole || span.covers(45 * k, 45 * (k + 1)) ? ALL
+                : span.meets(45 * k, 45 * (k + 1)) ? TEST
+                : SKIP;
+    }
+
+    int x = radius;
+    int y = 0;
+    int d = 1 - radius;
+    while (x >= y) {
+        for (int k = 0; k < 8; ++k) {
+            if (mode[k] == SKIP) {
+                continue;
+            }
+            const int* t = OCTANTS[k];
+            const int ox = x * t[0] + y * t[1];
+            const int oy = x * t[2] + y * t[3];
+            const long long px = static_cast<long long>(cx) + ox;
+            const long long py = static_cast<long long>(cy) + oy;
+            if (px < raster.x0 || px > raster.x1 || py < raster.y0 || py > raster.y1) {
+                continue;
+            }
+            if (mode[k] == TEST && !span.contains(ox, oy)) {
+                continue;
+            }
+            put<CHANNELS>(raster.pixel(static_cast<int>(px), static_cast<int>(py)), pixel);
+        }
+        ++y;
+        if (d < 0) {
+            d += 2 * y + 1;
+        } else {
+            --x;
+            d += 2 * (y - x) + 1;
+        }
+    }
+}
+
+template <int CHANNELS>
+void stamp(const Raster& raster, int x, int y, const Offset* offsets, std::size_t count,
+           bool inside, const Pixel& pixel) {
+    if (inside) {
+        unsigned char* const center = raster.pixel(x, y);
+        const std::ptrdiff_t step = static_cast<std::ptrdiff_t>(raster.step);
+        for (std::size_t i = 0; i < count; ++i) {
+            put<CHANNELS>(center + offsets[i].y * step + offsets[i].x * CHANNELS, pixel);
+        }
+        return;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        const int px = x + offsets[i].x;
+        const int py = y + offsets[i].y;
+        if (px >= raster.x0 && px <= raster.x1 && py >= raster.y0 && py <= raster.y1) {
+            put<CHANNELS>(raster.pixel(px, py), pixel);
+        }
+    }
+}
+
+template <int CHANNELS>
+void draw_batch(const Raster& raster,
+                const int* x_start, const int* y_start,
+                const int* x_end, const int* y_end,
+                const Pixel* pixels, std::size_t count) {
+    const unsigned width = static_cast<unsigned>(raster.width);
+    const unsigned height = static_cast<unsigned>(raster.height);
+    const int wx0 = raster.x0;
+    const int wy0 = raster.y0;
+    const int wx1 = raster.x1;
+    const int wy1 = raster.y1;
+    int inside[BATCH];
+    int visible[BATCH];
+    for (std::size_t base = 0; base < count; base += BATCH) {
+        const std::size_t n = std::min(BATCH, count - base);
+        const int* xs = x_start + base;
+        const int* ys = y_start + base;
+        const int* xe = x_end + base;
+        const int* ye = y_end + base;
+
+        // Clipping only shortens a segment, so one whose box misses the
+        // window draws nothing either way.
+        for (std::size_t i = 0; i < n; ++i) {
+            inside[i] = (static_cast<unsigned>(xs[i]) < width) &
+                        (static_cast<unsigned>(xe[i]) < width) &
+                        (static_cast<unsigned>(ys[i]) < height) &
+                        (static_cast<unsigned>(ye[i]) < height);
+            visible[i] = (std::max(xs[i], xe[i]) >= wx0) & (std::min(xs[i], xe[i]) <= wx1) &
+                         (std::max(ys[i], ye[i]) >= wy0) & (std::min(ys[i], ye[i]) <= wy1);
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!visible[i]) {
+                continue;
+            }
+            if (inside[i]) {
+                walk<CHANNELS>(raster, xs[i], ys[i], xe[i], ye[i], pixels[base + i]);
+                continue;
+            }
+            long long x1 = xs[i], y1 = ys[i], x2 = xe[i], y2 = ye[i];
+            if (clip(raster.width, raster.height, x1, y1, x2, y2)) {
+                walk<CHANNELS>(raster, static_cast<int>(x1), static_cast<int>(y1),
+                               static_cast<int>(x2), static_cast<int>(y2), pixels[base + i]);
+            }
+        }
+    }
+}
+
+} // namespace
+
+Raster::Raster(unsigned char* data, std::size_t step, int channels, int width, int height)
+    : data(data)
+    , step(step)
+    , channels(channels)
+    , width(width)
+    , height(height)
+    , x0(0)
+    , y0(0)
+    , x1(width - 1)
+    , y1(height - 1)
+    {}
+
+Raster::Raster(unsigned char* data, std::size_t step, int channels, int width, int height,
+               int x0, int y0, int x1, int y1)
+    : data(data)
+    , step(step)
+    , channels(channels)
+    , width(width)
+    , height(height)
+    , x0(x0)
+    , y0(y0)
+    , x1(x1)
+    , y1(y1)
+    {}
+
+Raster Raster::window(int wx0, int wy0, int wx1, int wy1) const {
+    Raster part(*this);
+    part.x0 = std::max(x0, wx0);
+    part.y0 = std::max(y0, wy0);
+    part.x1 = std::min(x1, wx1);
+    part.y1 = std::min(y1, wy1);
+    if (part.x0 <= part.x1 && part.y0 <= part.y1) {
+        part.data = pixel(part.x0, part.y0);
+    }
+    return part;
+}
+
+void draw_lines(const Raster& raster,
+                const int* x_start, const int* y_start,
+                const int* x_end, const int* y_end,
+                const Pixel* pixels, std::size_t count) {
+    if (raster.width <= 0 || raster.height <= 0 ||
+        raster.x0 > raster.x1 || raster.y0 > raster.y1) {
+        return;
+    }
+    if (raster.channels == 3) {
+        draw_batch<3>(raster, x_start, y_start, x_end, y_end, pixels, count);
+    } else {
+        draw_batch<1>(raster, x_start, y_start, x_end, y_end, pixels, count);
+    }
+}
+
+void draw_line(const Raster& raster, int x_start, int y_start, int x_end, int y_end,
+               const Pixel& pixel) {
+    draw_lines(raster, &x_start, &y_start, &x_end, &y_end, &pixel, 1);
+}
+
+ArcSpan arc_span(int start, int end) {
+    if (start > end) {
+        std::swap(start, end);
+    }
+    if (static_cast<long long>(end) - start >= 360) {
+        return ArcSpan{0, 360};
+    }
+    const int extent = end - start;
+    start %= 360;
+    return ArcSpan{start < 0 ? start + 360 : start, extent};
+}
+
+void draw_arc(const Raster& raster, int x_center, int y_center, int radius,
+              int start, int end, const Pixel& pixel) {
+    if (raster.x0 > raster.x1 || raster.y0 > raster.y1) {
+        return;
+    }
+    const long long r = std::llabs(radius);
+    if (x_center + r < raster.x0 || x_center - r > raster.x1 ||
+        y_center + r < raster.y0 || y_center - r > raster.y1) {
+        return;
+    }
+    if (r == 0) {
+        raster.channels == 3 ? put<3>(raster.pixel(x_center, y_center), pixel)
+                             : put<1>(raster.pixel(x_center, y_center), pixel);
+        return;
+    }
+    if (raster.channels == 3) {
+        arc<3>(raster, x_center, y_center, static_cast<int>(r), arc_span(start, end), pixel);
+    } else {
+        arc<1>(raster, x_center, y_center, static_cast<int>(r), arc_span(start, end), pixel);
+    }
+}
+
+void draw_stamp(const Raster& raster, int x, int y, const Offset* offsets, std::size_t count,
+                int reach, const Pixel& pixel) {
+    const long long lx = x;
+    const long long ly = y;
+    if (lx + reach < raster.x0 || lx - reach > raster.x1 ||
+        ly + reach < raster.y0 || ly - reach > raster.y1) {
+        return;
+    }
+    const bool inside = lx - reach >= raster.x0 && lx + reach <= raster.x1 &&
+                        ly - reach >= raster.y0 && ly + reach <= raster.y1;
+    if (raster.channels == 3) {
+        stamp<3>(raster, x, y, offsets, count, inside, pixel);
+    } else {
+        stamp<1>(raster, x, y, offsets, count, inside, pixel);
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef RASTER__H_
+#define RASTER__H_
+
+#include <cstddef>
+#include <cstdint>
+
+// The value written to each pixel: all three bytes on a BGR image, the first
+// one on a single-channel image (a palette index or a mask).
+struct Pixel {
+    unsigned char value[3];
+};
+
+// Where the built-in rasterisers write.  Geometry is always that of a whole
+// image of width x height pixels, which segments are clipped to exactly as
+// OpenCV clips them; only the pixels inside the window [x0, x1] x [y0, y1]
+// of that image are written.  data points at pixel (x0, y0), so a window
+// can be a tile of the image or a buffer of its own.
+struct Raster {
+    // The whole of an image.
+    Raster(unsigned char* data, std::size_t step, int channels, int width, int height);
+
+    // A window of an image, with its own pixel storage.
+    Raster(unsigned char* data, std::size_t step, int channels, int width, int height,
+           int x0, int y0, int x1, int y1);
+
+    // The part of this raster's window inside [x0, x1] x [y0, y1], sharing
+    // its pixels.
+    Raster window(int x0, int y0, int x1, int y1) const;
+
+    unsigned char* pixel(int x, int y) const {
+        return data + (y - y0) * step + (x - x0) * channels;
+    }
+
+    unsigned char* data;
+    std::size_t step;
+    int channels;       // 1 or 3
+    int width;
+    int height;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+// One-pixel-wide 8-connected segments between integer points, with the
+// pixels of cv::line(image, start, end, color) at thickness 1, LINE_8: each
+// segment is clipped to the image as cv::clipLine() does, then walked from
+// its left end by the same integer Bresenham steps.
+//
+// Segments are set up in batches: end-point classification against the
+// image and the window runs as branch-free loops over the coordinate
+// arrays, which the compiler vectorises, so segments wholly outside the
+// window cost no walk and only those leaving the image are clipped.
+void draw_lines(const Raster& raster,
+                const int* x_start, const int* y_start,
+                const int* x_end, const int* y_end,
+                const Pixel* pixels, std::size_t count);
+
+void draw_line(const Raster& raster, int x_start, int y_start, int x_end, int y_end,
+               const Pixel& pixel);
+
+// One-pixel-wide arc of a circle around an integer center, by the midpoint
+// circle algorithm: one octant is walked and mirrored into the other seven.
+// Angles are in whole degrees from +x towards +y (clockwise on screen, since
+// y points down), with the conventions of cv::ellipse(): start and end are
+// swapped if start > end, an arc spanning 360 degrees or more is the whole
+// circle, and otherwise both are taken modulo 360.  A pixel is drawn if its
+// direction from the center lies within [start, end]; this is decided with
+// integer cross products against a fixed table of whole-degree directions,
+// and only octants the arc ends in need testing at all.  A radius of 0 sets
+// the center pixel.
+void draw_arc(const Raster& raster, int x_center, int y_center, int radius,
+              int start, int end, const Pixel& pixel);
+
+// The directions draw_arc() draws for start and end: extent degrees on from
+// start, with start in [0, 360).  An extent of 360 is the whole circle, and
+// then start is 0.
+struct ArcSpan {
+    int start;
+    int extent;
+};
+
+ArcSpan arc_span(int start, int end);
+
+// A pixel relative to a center.
+struct Offset {
+    std::int16_t x;
+    std::int16_t y;
+};
+
+// Sets the pixels at offsets from (x, y), such as a pre-rasterised arc.
+// No offset may be more than reach pixels from the center in x or y.
+void draw_stamp(const Raster& raster, int x, int y, const Offset* offsets, std::size_t count,
+                int reach, const Pixel& pixel);
+
+#endif // RASTER__H_
@@ -0,0 +1,331 @@
+#include "render.h"
+#include "raster.h"
+#include "scene.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Segments handed to draw_lines() at a time.
+const std::size_t BATCH = 64;
+
+// Inclusive pixel box; empty if x0 > x1 or y0 > y1.
+struct Box {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+
+    bool empty() const { return x0 > x1 || y0 > y1; }
+};
+
+Box intersect(const Box& a, const Box& b) {
+    return Box{std::max(a.x0, b.x0), std::max(a.y0, b.y0),
+               std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+}
+
+Pixel color_to_pixel(Color color) {
+    const cv::Scalar scalar = color_to_scalar(color);
+    Pixel pixel;
+    for (int c = 0; c < 3; ++c) {
+        pixel.value[c] = cv::saturate_cast<unsigned char>(scalar[c]);
+    }
+    return pixel;
+}
+
+Raster raster(cv::Mat& image) {
+    return Raster(image.data, image.step, image.channels(), image.cols, image.rows);
+}
+
+// The integer end points cv::line() gets from drawline(): Point2f rounded.
+void endpoints(const Line& line, int& xs, int& ys, int& xe, int& ye) {
+    const cv::Point start = cv::Point2f(line.x_start, line.y_start);
+    const cv::Point end = cv::Point2f(line.x_end, line.y_end);
+    xs = start.x;
+    ys = start.y;
+    xe = end.x;
+    ye = end.y;
+}
+
+// The integer geometry of an arc: center rounded from Point2f, radius
+// truncated and angles rounded to whole degrees, as cv::ellipse() takes them.
+struct Shape {
+    int x;
+    int y;
+    int radius;
+    int start;
+    int end;
+    Pixel pixel;
+};
+
+Shape shape(const Arc& arc) {
+    const cv::Point center = cv::Point2f(arc.x_center, arc.y_center);
+    Shape s;
+    s.x = center.x;
+    s.y = center.y;
+    s.radius = cv::Size(arc.radius, arc.radius).width;
+    s.start = cvRound(arc.arc_start);
+    s.end = cvRound(arc.arc_start + arc.arc_extend);
+    s.pixel = color_to_pixel(arc.color);
+    return s;
+}
+
+Box bounds(const Shape& s) {
+    const int r = std::abs(s.radius);
+    return Box{s.x - r, s.y - r, s.x + r, s.y + r};
+}
+
+void draw(const Raster& raster, const Shape& s, StampCache& stamps) {
+    stamps.draw(raster, s.x, s.y, s.radius, s.start, s.end, s.pixel);
+}
+
+// Whether the columns of scene already hold the integer geometry: fixed point
+// at one unit per pixel, as to_image() leaves a scene that stays fixed.
+// Rounding and truncating whole numbers changes nothing, so reading them
+// directly gives the same integers as endpoints() and shape().
+bool whole_pixels(const Scene& scene) {
+    return scene.fixed() && scene.scale() == 1;
+}
+
+// endpoints() and the pixel of line i of scene.
+void line_at(const Scene& scene, bool whole, std::size_t i,
+             int& xs, int& ys, int& xe, int& ye, Pixel& pixel) {
+    if (whole) {
+        const Scene::FixedLines& lines = scene.fixed_lines();
+        xs = lines.x_start[i];
+        ys = lines.y_start[i];
+        xe = lines.x_end[i];
+        ye = lines.y_end[i];
+        pixel = color_to_pixel(lines.color[i]);
+        return;
+    }
+    const Line line = scene.line(i);
+    endpoints(line, xs, ys, xe, ye);
+    pixel = color_to_pixel(line.color);
+}
+
+// shape() of arc i of scene.
+Shape arc_at(const Scene& scene, bool whole, std::size_t i) {
+    if (!whole) {
+        return shape(scene.arc(i));
+    }
+    const Scene::FixedArcs& arcs = scene.fixed_arcs();
+    Shape s;
+    s.x = arcs.x_center[i];
+    s.y = arcs.y_center[i];
+    s.radius = arcs.radius[i];
+    s.start = arcs.arc_start[i];
+    s.end = arcs.arc_start[i] + arcs.arc_extend[i];
+    s.pixel = color_to_pixel(arcs.color[i]);
+    return s;
+}
+
+// Everything the workers share.  Primitives are numbered in drawing order,
+// lines then arcs; tile t holds items[first[t]] up to items[first[t + 1]],
+// so its lines come before its arcs.
+struct Job {
+    cv::Mat* image;
+    int tile;
+    int columns;
+    std::size_t tiles;
+    std::size_t lines;
+    std::vector<int> x_start;
+    std::vector<int> y_start;
+    std::vector<int> x_end;
+    std::vector<int> y_end;
+    std::vector<Pixel> pixels;
+    std::vector<Shape> arcs;            // primitive lines + i is arcs[i]
+    std::vector<Box> boxes;             // within the image
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> items;
+    std::atomic<std::size_t> next;
+};
+
+void draw_tile(Job& job, std::size_t t, StampCache& stamps) {
+    const std::uint32_t* item = job.items.data() + job.first[t];
+    const std::uint32_t* const last = job.items.data() + job.first[t + 1];
+    if (item == last) {
+        return;
+    }
+    const int x = static_cast<int>(t % job.columns) * job.tile;
+    const int y = static_cast<int>(t / job.columns) * job.tile;
+    const Raster tile = raster(*job.image).window(x, y, x + job.tile - 1, y + job.tile - 1);
+
+    int xs[BATCH], ys[BATCH], xe[BATCH], ye[BATCH];
+    Pixel pixels[BATCH];
+    while (item != last && *item < job.lines) {
+        std::size_t n = 0;
+        for (; item != last && *item < job.lines && n < BATCH; ++item, ++n) {
+            xs[n] = job.x_start[*item];
+            ys[n] = job.y_start[*item];
+            xe[n] = job.x_end[*item];
+            ye[n] = job.y_end[*item];
+            pixels[n] = job.pixels[*item];
+        }
+        draw_lines(tile, xs, ys, xe, ye, pixels, n);
+    }
+    for (; item != last; ++item) {
+        draw(tile, job.arcs[*item - job.lines], stamps);
+    }
+}
+
+void work(Job& job, StampCache& stamps) {
+    for (std::size_t t = job.next++; t < job.tiles; t = job.next++) {
+        draw_tile(job, t, stamps);
+    }
+}
+
+} // namespace
+
+cv::Scalar color_to_scalar(Color color) {
+    switch (color) {
+    case Color::Blue:
+        return CV_RGB(0, 0, 255);
+    case Color::Green:
+        return CV_RGB(0, 204, 0);
+    case Color::Red:
+        return CV_RGB(255, 0, 0);
+    case Color::Yellow:
+        return CV_RGB(204, 204, 0);
+    case Color::White:
+    default:
+        return CV_RGB(255, 255, 255);
+    }
+}
+
+void drawline(cv::Mat& image, const Line& line) {
+    int xs, ys, xe, ye;
+    endpoints(line, xs, ys, xe, ye);
+    draw_line(raster(image), xs, ys, xe, ye, color_to_pixel(line.color));
+}
+
+void drawlines(cv::Mat& image, const Scene& scene) {
+    const Raster whole = raster(image);
+    int xs[BATCH], ys[BATCH], xe[BATCH], ye[BATCH];
+    Pixel pixels[BATCH];
+    const bool fixed = whole_pixels(scene);
+    for (std::size_t base = 0; base < scene.line_count(); base += BATCH) {
+        const std::size_t n = std::min(BATCH, scene.line_count() - base);
+        for (std::size_t i = 0; i < n; ++i) {
+            line_at(scene, fixed, base + i, xs[i], ys[i], xe[i], ye[i], pixels[i]);
+        }
+        draw_lines(whole, xs, ys, xe, ye, pixels, n);
+    }
+}
+
+void drawarc(cv::Mat& image, const Arc& arc) {
+    const Shape s = shape(arc);
+    draw_arc(raster(image), s.x, s.y, s.radius, s.start, s.end, s.pixel);
+}
+
+void drawarc(cv::Mat& image, const Arc& arc, StampCache& stamps) {
+    draw(raster(image), shape(arc), stamps);
+}
+
+void drawarcs(cv::Mat& image, const Scene& scene, StampCache& stamps) {
+    const Raster whole = raster(image);
+    const bool fixed = whole_pixels(scene);
+    for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+        draw(whole, arc_at(scene, fixed, i), stamps);
+    }
+}
+
+const int TileRenderer::DEFAULT_TILE;
+
+TileRenderer::TileRenderer(unsigned threads, int tile, std::size_t stamp_budget)
+    : m_threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    , m_tile(std::max(tile, 1))
+    , m_stamp_budget(stamp_budget)
+    , m_stamp_hits(0)
+    , m_stamp_misses(0)
+    {}
+
+void TileRenderer::render(const Scene& scene, cv::Mat& image) {
+    Job job;
+    job.image = &image;
+    job.tile = m_tile;
+    job.columns = (image.cols + m_tile - 1) / m_tile;
+    job.tiles = static_cast<std::size_t>(job.columns) * ((image.rows + m_tile - 1) / m_tile);
+    job.next = 0;
+
+    // Lines, then arcs: the drawing order.
+    job.lines = scene.line_count();
+    const std::size_t count = job.lines + scene.arc_count();
+    job.x_start.resize(job.lines);
+    job.y_start.resize(job.lines);
+    job.x_end.resize(job.lines);
+    job.y_end.resize(job.lines);
+    job.pixels.resize(job.lines);
+    job.boxes.resize(count);
+    const bool fixed = whole_pixels(scene);
+    for (std::size_t i = 0; i < job.lines; ++i) {
+        int& xs = job.x_start[i];
+        int& ys = job.y_start[i];
+        int& xe = job.x_end[i];
+        int& ye = job.y_end[i];
+        line_at(scene, fixed, i, xs, ys, xe, ye, job.pixels[i]);
+        job.boxes[i] = Box{std::min(xs, xe), std::min(ys, ye), std::max(xs, xe), std::max(ys, ye)};
+    }
+    job.arcs.reserve(scene.arc_count());
+    for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+        job.arcs.push_back(arc_at(scene, fixed, i));
+        job.boxes[job.lines + i] = bounds(job.arcs.back());
+    }
+
+    // Bin by counting sort, so that every tile keeps the drawing order.
+    const Box whole{0, 0, image.cols - 1, image.rows - 1};
+    job.first.assign(job.tiles + 1, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Box box = intersect(job.boxes[i], whole);
+        job.boxes[i] = box;
+        if (box.empty()) {
+            continue;
+        }
+        for (int ty = box.y0 / m_tile; ty <= box.y1 / m_tile; ++ty) {
+            for (int tx = box.x0 / m_tile; tx <= box.x1 / m_tile; ++tx) {
+                ++job.first[ty * job.columns + tx + 1];
+            }
+        }
+    }
+    for (std::size_t t = 0; t < job.tiles; ++t) {
+        job.first[t + 1] += job.first[t];
+    }
+    job.items.resize(job.first.back());
+    std::vector<std::uint32_t> fill(job.first.begin(), job.first.end() - 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Box& box = job.boxes[i];
+        if (box.empty()) {
+            continue;
+        }
+        for (int ty = box.y0 / m_tile; ty <= box.y1 / m_tile; ++ty) {
+            for (int tx = box.x0 / m_tile; tx <= box.x1 / m_tile; ++tx) {
+                job.items[fill[ty * job.columns + tx]++] = static_cast<std::uint32_t>(i);
+            }
+        }
+    }
+
+    // One stamp cache per thread, sharing the budget.
+    std::vector<std::thread> workers;
+    const std::size_t threads =
+        std::max<std::size_t>(std::min<std::size_t>(m_threads, job.tiles), 1);
+    std::deque<StampCache> stamps;
+    for (std::size_t i = 0; i < threads; ++i) {
+        stamps.emplace_back(m_stamp_budget / threads);
+    }
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(work, std::ref(job), std::ref(stamps[i])));
+    }
+    work(job, stamps[0]);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const StampCache& cache : stamps) {
+        m_stamp_hits += cache.hits();
+        m_stamp_misses += cache.misses();
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef RENDER__H_
+#define RENDER__H_
+
+#include "plot.h"
+#include "stamp_cache.h"
+#include <cstddef>
+#include <opencv2/opencv.hpp>
+
+class Scene;
+
+cv::Scalar color_to_scalar(Color color);
+
+// Draw one primitive, in image coordinates (see to_image()), with the built-in
+// rasterisers (raster.h).  Lines get the pixels cv::line() would set; arcs
+// are midpoint circles cut to whole-degree angles, with cv::ellipse()'s
+// angle conventions.
+void drawline(cv::Mat& image, const Line& line);
+void drawarc(cv::Mat& image, const Arc& arc);
+
+// drawarc(), from a stamp of the arc's shape when stamps has or can make one.
+void drawarc(cv::Mat& image, const Arc& arc, StampCache& stamps);
+
+// drawline() on every line of scene, in batches, and drawarc() through
+// stamps on every arc.  A fixed-point scene at one unit per pixel is read
+// from its integer columns without going through Line and Arc.
+void drawlines(cv::Mat& image, const Scene& scene);
+void drawarcs(cv::Mat& image, const Scene& scene, StampCache& stamps);
+
+// Draws a Scene on several threads, with the same pixels as calling
+// drawline() on every line and then drawarc() on every arc.
+//
+// The image is cut into square tiles.  Each primitive is binned into the
+// tiles its pixel bounding box overlaps, in drawing order, and worker
+// threads take tiles one at a time.  The rasterisers clip every primitive
+// to the whole image and write only its pixels inside the tile, so the
+// result is bit-identical and threads never write the same pixel.  Each
+// thread draws arcs through a StampCache of its own, with an equal share of
+// stamp_budget bytes.
+class TileRenderer {
+public:
+    static const int DEFAULT_TILE = 128;
+
+    // threads 0 means one per hardware thread.
+    explicit TileRenderer(unsigned threads = 0, int tile = DEFAULT_TILE,
+                          std::size_t stamp_budget = StampCache::DEFAULT_BUDGET);
+
+    // image must be CV_8UC3; scene is in image coordinates.
+    void render(const Scene& scene, cv::Mat& image);
+
+    // Stamp cache hits and misses over every render() so far.
+    std::size_t stamp_hits() const { return m_stamp_hits; }
+    std::size_t stamp_misses() const { return m_stamp_misses; }
+
+private:
+    unsigned m_threads;
+    int m_tile;
+    std::size_t m_stamp_budget;
+    std::size_t m_stamp_hits;
+    std::size_t m_stamp_misses;
+};
+
+#endif // RENDER__H_
@@ -0,0 +1,602 @@
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+namespace {
+
+const std::size_t COLORS = static_cast<std::size_t>(Color::White) + 1;
+
+// Range of fixed-point values, symmetric so that negating one always fits.
+const int FIXED_MAX = std::numeric_limits<std::int16_t>::max();
+
+bool fits(long value) {
+    return value >= -FIXED_MAX && value <= FIXED_MAX;
+}
+
+// Stores value * scale in fixed if that is exact and fits.
+bool quantize(double value, int scale, std::int16_t& fixed) {
+    const double scaled = value * scale;
+    if (!(std::fabs(scaled) <= FIXED_MAX + 1)) {
+        return false; // out of range or NaN
+    }
+    const long q = std::lrint(scaled);
+    if (!fits(q) || q / static_cast<double>(scale) != value) {
+        return false;
+    }
+    fixed = static_cast<std::int16_t>(q);
+    return true;
+}
+
+// Calls f on every column.
+template<typename T, typename F>
+void each(LineColumns<T>& c, F f) {
+    f(c.x_start);
+    f(c.x_end);
+    f(c.y_start);
+    f(c.y_end);
+    f(c.color);
+}
+
+template<typename T, typename F>
+void each(ArcColumns<T>& c, F f) {
+    f(c.x_center);
+    f(c.y_center);
+    f(c.radius);
+    f(c.arc_start);
+    f(c.arc_extend);
+    f(c.color);
+}
+
+template<typename T, typename F>
+void each(const LineColumns<T>& c, F f) {
+    f(c.x_start);
+    f(c.x_end);
+    f(c.y_start);
+    f(c.y_end);
+    f(c.color);
+}
+
+template<typename T, typename F>
+void each(const ArcColumns<T>& c, F f) {
+    f(c.x_center);
+    f(c.y_center);
+    f(c.radius);
+    f(c.arc_start);
+    f(c.arc_extend);
+    f(c.color);
+}
+
+// Calls f on every pair of matching columns.
+template<typename T, typename F>
+void each(LineColumns<T>& a, const LineColumns<T>& b, F f) {
+    f(a.x_start, b.x_start);
+    f(a.x_end, b.x_end);
+    f(a.y_start, b.y_start);
+    f(a.y_end, b.y_end);
+    f(a.color, b.color);
+}
+
+template<typename T, typename F>
+void each(ArcColumns<T>& a, const ArcColumns<T>& b, F f) {
+    f(a.x_center, b.x_center);
+    f(a.y_center, b.y_center);
+    f(a.radius, b.radius);
+    f(a.arc_start, b.arc_start);
+    f(a.arc_extend, b.arc_extend);
+    f(a.color, b.color);
+}
+
+// Removes the elements whose keep flag is 0, keeping the order of the rest.
+struct Compact {
+    const std::vector<unsigned char>& keep;
+
+    template<typename T>
+    void operator()(std::vector<T>& column) const {
+        std::size_t out = 0;
+        for (std::size_t i = 0; i < column.size(); ++i) {
+            column[out] = column[i];
+            out += keep[i];
+        }
+        column.resize(out);
+    }
+};
+
+// Reorders a column so that element i is the old element order[i].
+struct Permute {
+    const std::vector<std::size_t>& order;
+
+    template<typename T>
+    void operator()(std::vector<T>& column) const {
+        std::vector<T> sorted(column.size());
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            sorted[i] = column[order[i]];
+        }
+        column.swap(sorted);
+    }
+};
+
+struct Reserve {
+    std::size_t size;
+
+    template<typename T>
+    void operator()(std::vector<T>& column) const {
+        column.reserve(size);
+    }
+};
+
+struct Append {
+    template<typename T>
+    void operator()(std::vector<T>& to, const std::vector<T>& from) const {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+};
+
+struct Bytes {
+    std::size_t& total;
+
+    template<typename T>
+    void operator()(const std::vector<T>& column) const {
+        total += column.size() * sizeof(T);
+    }
+};
+
+// Stable counting sort of indices by color.
+std::vector<std::size_t> color_order(const std::vector<Color>& colors) {
+    std::size_t start[COLORS + 1] = {};
+    for (const Color color : colors) {
+        ++start[static_cast<std::size_t>(color) + 1];
+    }
+    for (std::size_t c = 1; c <= COLORS; ++c) {
+        start[c] += start[c - 1];
+    }
+    std::vector<std::size_t> order(colors.size());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        order[start[static_cast<std::size_t>(colors[i])]++] = i;
+    }
+    return order;
+}
+
+std::vector<double> to_doubles(const std::vector<std::int16_t>& column, int scale) {
+    std::vector<double> result(column.size());
+    for (std::size_t i = 0; i < column.size(); ++i) {
+        result[i] = column[i] / static_cast<double>(scale);
+    }
+    return result;
+}
+
+// x becomes (x - x_origin) * scale, y becomes top - y * scale, radii are
+// multiplied by scale, and [start, start + extend] becomes
+// [-(start + extend), -start], kept in the same range as before, since
+// mirroring maps angle a to -a.  T is double or int16_t; in the latter case
+// the values are in fixed point, scale is 1 and the caller has checked the
+// results.
+template<typename T, typename W>
+void transform(LineColumns<T>& lines, ArcColumns<T>& arcs,
+               W x_origin, W top, W scale, W turn) {
+    for (T& x : lines.x_start) {
+        x = static_cast<T>((x - x_origin) * scale);
+    }
+    for (T& x : lines.x_end) {
+        x = static_cast<T>((x - x_origin) * scale);
+    }
+    for (T& y : lines.y_start) {
+        y = static_cast<T>(top - y * scale);
+    }
+    for (T& y : lines.y_end) {
+        y = static_cast<T>(top - y * scale);
+    }
+    for (T& x : arcs.x_center) {
+        x = static_cast<T>((x - x_origin) * scale);
+    }
+    for (T& y : arcs.y_center) {
+        y = static_cast<T>(top - y * scale);
+    }
+    for (T& r : arcs.radius) {
+        r = static_cast<T>(r * scale);
+    }
+    T* start = arcs.arc_start.data();
+    const T* extend = arcs.arc_extend.data();
+    for (std::size_t i = 0; i < arcs.arc_start.size(); ++i) {
+        start[i] = static_cast<T>(turn - (start[i] + extend[i]));
+    }
+}
+
+// Whether transform() in fixed point, at scale 1, keeps every value in range.
+bool can_transform(const Scene::FixedLines& lines, const Scene::FixedArcs& arcs,
+                   long x_origin, long top, long turn) {
+    bool ok = fits(x_origin) && fits(top) && fits(turn);
+    for (const std::int16_t x : lines.x_start) {
+        ok &= fits(x - x_origin);
+    }
+    for (const std::int16_t x : lines.x_end) {
+        ok &= fits(x - x_origin);
+    }
+    for (const std::int16_t y : lines.y_start) {
+        ok &= fits(top - y);
+    }
+    for (const std::int16_t y : lines.y_end) {
+        ok &= fits(top - y);
+    }
+    for (const std::int16_t x : arcs.x_center) {
+        ok &= fits(x - x_origin);
+    }
+    for (const std::int16_t y : arcs.y_center) {
+        ok &= fits(top - y);
+    }
+    for (std::size_t i = 0; i < arcs.arc_start.size(); ++i) {
+        ok &= fits(turn - (arcs.arc_start[i] + arcs.arc_extend[i]));
+    }
+    return ok;
+}
+
+// Bounds in the units of the columns; W is wide enough for x +- r.
+template<typename T, typename W>
+Bounds bounds_of(const LineColumns<T>& lines, const ArcColumns<T>& arcs, double scale) {
+    W x0 = std::numeric_limits<W>::max();
+    W y0 = std::numeric_limits<W>::max();
+    W x1 = std::numeric_limits<W>::lowest();
+    W y1 = std::numeric_limits<W>::lowest();
+    for (std::size_t i = 0; i < lines.color.size(); ++i) {
+        x0 = std::min(x0, static_cast<W>(std::min(lines.x_start[i], lines.x_end[i])));
+        x1 = std::max(x1, static_cast<W>(std::max(lines.x_start[i], lines.x_end[i])));
+        y0 = std::min(y0, static_cast<W>(std::min(lines.y_start[i], lines.y_end[i])));
+        y1 = std::max(y1, static_cast<W>(std::max(lines.y_start[i], lines.y_end[i])));
+    }
+    for (std::size_t i = 0; i < arcs.color.size(); ++i) {
+        const W r = std::abs(static_cast<W>(arcs.radius[i]));
+        x0 = std::min(x0, arcs.x_center[i] - r);
+        x1 = std::max(x1, arcs.x_center[i] + r);
+        y0 = std::min(y0, arcs.y_center[i] - r);
+        y1 = std::max(y1, arcs.y_center[i] + r);
+    }
+    if (lines.color.empty() && arcs.color.empty()) {
+        return Bounds();
+    }
+    return Bounds(x0 / scale, y0 / scale, x1 / scale, y1 / scale);
+}
+
+// Columns hold value * scale.
+template<typename T>
+void cull(LineColumns<T>& lines, ArcColumns<T>& arcs, const Bounds& view, double scale) {
+    std::vector<unsigned char> keep(lines.color.size());
+    for (std::size_t i = 0; i < keep.size(); ++i) {
+        const double x0 = std::min(lines.x_start[i], lines.x_end[i]) / scale;
+        const double x1 = std::max(lines.x_start[i], lines.x_end[i]) / scale;
+        const double y0 = std::min(lines.y_start[i], lines.y_end[i]) / scale;
+        const double y1 = std::max(lines.y_start[i], lines.y_end[i]) / scale;
+        keep[i] = (x1 >= view.x_min) & (x0 <= view.x_max) &
+                  (y1 >= view.y_min) & (y0 <= view.y_max);
+    }
+    each(lines, Compact{keep});
+
+    keep.assign(arcs.color.size(), 0);
+    for (std::size_t i = 0; i < keep.size(); ++i) {
+        const double r = std::fabs(arcs.radius[i] / scale);
+        const double x = arcs.x_center[i] / scale;
+        const double y = arcs.y_center[i] / scale;
+        keep[i] = (x + r >= view.x_min) & (x - r <= view.x_max) &
+                  (y + r >= view.y_min) & (y - r <= view.y_max);
+    }
+    each(arcs, Compact{keep});
+}
+
+template<typename T>
+void sort_by_color(LineColumns<T>& lines, ArcColumns<T>& arcs) {
+    each(lines, Permute{color_order(lines.color)});
+    each(arcs, Permute{color_order(arcs.color)});
+}
+
+// The side of a canvas showing extent at scale.  It is bounded while still a
+// double: one too large (or NaN) would not convert to int.
+int fit_side(double extent, double scale) {
+    const double side = std::floor(extent * scale) + 1;
+    if (!(side <= Canvas::MAX_SIDE)) {
+        return Canvas::MAX_SIDE + 1;
+    }
+    return side < 1 ? 0 : static_cast<int>(side);
+}
+
+} // namespace
+
+Bounds::Bounds()
+    : x_min(std::numeric_limits<double>::infinity())
+    , y_min(std::numeric_limits<double>::infinity())
+    , x_max(-std::numeric_limits<double>::infinity())
+    , y_max(-std::numeric_limits<double>::infinity())
+    {}
+
+Bounds::Bounds(double x0, double y0, double x1, double y1)
+    : x_min(x0)
+    , y_min(y0)
+    , x_max(x1)
+    , y_max(y1)
+    {}
+
+void Bounds::include(const Line& line) {
+    x_min = std::min(x_min, std::min(line.x_start, line.x_end));
+    x_max = std::max(x_max, std::max(line.x_start, line.x_end));
+    y_min = std::min(y_min, std::min(line.y_start, line.y_end));
+    y_max = std::max(y_max, std::max(line.y_start, line.y_end));
+}
+
+void Bounds::include(const Arc& arc) {
+    const double r = std::fabs(arc.radius);
+    x_min = std::min(x_min, arc.x_center - r);
+    x_max = std::max(x_max, arc.x_center + r);
+    y_min = std::min(y_min, arc.y_center - r);
+    y_max = std::max(y_max, arc.y_center + r);
+}
+
+const int Canvas::MAX_SIDE;
+
+Canvas::Canvas(int width, int height, double x_origin, double y_origin, double scale)
+    : width(width)
+    , height(height)
+    , x_origin(x_origin)
+    , y_origin(y_origin)
+    , scale(scale)
+    {}
+
+Canvas Canvas::fit(const Bounds& bounds, int width, int height, double scale) {
+    if (bounds.empty()) {
+        return Canvas(width ? width : 1, height ? height : 1, 0, 0, scale);
+    }
+    const double w = bounds.x_max - bounds.x_min;
+    const double h = bounds.y_max - bounds.y_min;
+    if (width > 0 && height > 0) {
+        // Pixel centers run from 0 to width - 1 and height - 1.
+        const double sx = w > 0 ? (width - 1) / w : std::numeric_limits<double>::infinity();
+        const double sy = h > 0 ? (height - 1) / h : std::numeric_limits<double>::infinity();
+        // A side of one pixel fits nothing but a point: the requested scale
+        // is kept then, as it is for a point, rather than scaling to 0.
+        const double s = std::min(sx, sy);
+        if (s > 0 && s < std::numeric_limits<double>::infinity()) {
+            scale = s;
+        }
+    }
+    if (width <= 0) {
+        width = fit_side(w, scale);
+    }
+    if (height <= 0) {
+        height = fit_side(h, scale);
+    }
+    // Spread the spare pixels evenly on both sides.  The bottom row is
+    // height - 1, one pixel above y = y_origin.
+    const double x_origin = bounds.x_min - (width - 1 - w * scale) / 2 / scale;
+    const double y_origin = bounds.y_min - (1 + (height - 1 - h * scale) / 2) / scale;
+    return Canvas(width, height, x_origin, y_origin, scale);
+}
+
+bool Canvas::valid() const {
+    return width >= 1 && height >= 1 && width <= MAX_SIDE && height <= MAX_SIDE &&
+           std::isfinite(x_origin) && std::isfinite(y_origin) &&
+           std::isfinite(scale) && scale > 0;
+}
+
+Scene::Scene()
+    : m_scale(0)
+    , m_fixed(false)
+    {}
+
+Scene::Scene(int scale)
+    : m_scale(scale)
+    , m_fixed(true)
+    {}
+
+void Scene::add(const Line& line) {
+    std::int16_t q[4];
+    if (m_fixed) {
+        if (quantize(line.x_start, m_scale, q[0]) && quantize(line.x_end, m_scale, q[1]) &&
+            quantize(line.y_start, m_scale, q[2]) && quantize(line.y_end, m_scale, q[3])) {
+            m_fixed_lines.x_start.push_back(q[0]);
+            m_fixed_lines.x_end.push_back(q[1]);
+            m_fixed_lines.y_start.push_back(q[2]);
+            m_fixed_lines.y_end.push_back(q[3]);
+            m_fixed_lines.color.push_back(line.color);
+            return;
+        }
+        to_doubles();
+    }
+    m_lines.x_start.push_back(line.x_start);
+    m_lines.x_end.push_back(line.x_end);
+    m_lines.y_start.push_back(line.y_start);
+    m_lines.y_end.push_back(line.y_end);
+    m_lines.color.push_back(line.color);
+}
+
+void Scene::add(const Arc& arc) {
+    std::int16_t q[5];
+    if (m_fixed) {
+        if (quantize(arc.x_center, m_scale, q[0]) && quantize(arc.y_center, m_scale, q[1]) &&
+            quantize(arc.radius, m_scale, q[2]) && quantize(arc.arc_start, m_scale, q[3]) &&
+            quantize(arc.arc_extend, m_scale, q[4])) {
+            m_fixed_arcs.x_center.push_back(q[0]);
+            m_fixed_arcs.y_center.push_back(q[1]);
+            m_fixed_arcs.radius.push_back(q[2]);
+            m_fixed_arcs.arc_start.push_back(q[3]);
+            m_fixed_arcs.arc_extend.push_back(q[4]);
+            m_fixed_arcs.color.push_back(arc.color);
+            return;
+        }
+        to_doubles();
+    }
+    m_arcs.x_center.push_back(arc.x_center);
+    m_arcs.y_center.push_back(arc.y_center);
+    m_arcs.radius.push_back(arc.radius);
+    m_arcs.arc_start.push_back(arc.arc_start);
+    m_arcs.arc_extend.push_back(arc.arc_extend);
+    m_arcs.color.push_back(arc.color);
+}
+
+void Scene::append(const Scene& other) {
+    if (m_fixed && other.m_fixed && m_scale == other.m_scale) {
+        each(m_fixed_lines, other.m_fixed_lines, Append());
+        each(m_fixed_arcs, other.m_fixed_arcs, Append());
+    } else if (!m_fixed && !other.m_fixed) {
+        each(m_lines, other.m_lines, Append());
+        each(m_arcs, other.m_arcs, Append());
+    } else {
+        for (std::size_t i = 0; i < other.line_count(); ++i) {
+            add(other.line(i));
+        }
+        for (std::size_t i = 0; i < other.arc_count(); ++i) {
+            add(other.arc(i));
+        }
+    }
+}
+
+void Scene::reserve(std::size_t lines, std::size_t arcs) {
+    if (m_fixed) {
+        each(m_fixed_lines, Reserve{lines});
+        each(m_fixed_arcs, Reserve{arcs});
+    } else {
+        each(m_lines, Reserve{lines});
+        each(m_arcs, Reserve{arcs});
+    }
+}
+
+void Scene::assign(Lines lines, Arcs arcs) {
+    clear();
+    m_lines = std::move(lines);
+    m_arcs = std::move(arcs);
+    m_fixed = false;
+}
+
+void Scene::assign(FixedLines lines, FixedArcs arcs) {
+    clear();
+    m_fixed_lines = std::move(lines);
+    m_fixed_arcs = std::move(arcs);
+    m_fixed = true;
+}
+
+void Scene::clear() {
+    m_lines = Lines();
+    m_arcs = Arcs();
+    m_fixed_lines = FixedLines();
+    m_fixed_arcs = FixedArcs();
+    m_fixed = m_scale != 0;
+}
+
+std::size_t Scene::line_count() const {
+    return m_fixed ? m_fixed_lines.color.size() : m_lines.color.size();
+}
+
+std::size_t Scene::arc_count() const {
+    return m_fixed ? m_fixed_arcs.color.size() : m_arcs.color.size();
+}
+
+Line Scene::line(std::size_t i) const {
+    if (m_fixed) {
+        const double s = m_scale;
+        return Line(m_fixed_lines.x_start[i] / s, m_fixed_lines.x_end[i] / s,
+                    m_fixed_lines.y_start[i] / s, m_fixed_lines.y_end[i] / s,
+                    m_fixed_lines.color[i]);
+    }
+    return Line(m_lines.x_start[i], m_lines.x_end[i],
+                m_lines.y_start[i], m_lines.y_end[i], m_lines.color[i]);
+}
+
+Arc Scene::arc(std::size_t i) const {
+    if (m_fixed) {
+        const double s = m_scale;
+        return Arc(m_fixed_arcs.x_center[i] / s, m_fixed_arcs.y_center[i] / s,
+                   m_fixed_arcs.radius[i] / s, m_fixed_arcs.arc_start[i] / s,
+                   m_fixed_arcs.arc_extend[i] / s, m_fixed_arcs.color[i]);
+    }
+    return Arc(m_arcs.x_center[i], m_arcs.y_center[i], m_arcs.radius[i],
+               m_arcs.arc_start[i], m_arcs.arc_extend[i], m_arcs.color[i]);
+}
+
+void Scene::to_image(const Canvas& canvas) {
+    const double top = canvas.height + canvas.y_origin * canvas.scale;
+    if (m_fixed) {
+        // In units of 1 / m_scale.
+        const double x_origin = canvas.x_origin * m_scale;
+        const double y_top = top * m_scale;
+        const long fixed_x_origin = std::lrint(x_origin);
+        const long fixed_top = std::lrint(y_top);
+        const long turn = 360L * m_scale;
+        if (canvas.scale == 1 && fixed_x_origin == x_origin && fixed_top == y_top &&
+            can_transform(m_fixed_lines, m_fixed_arcs, fixed_x_origin, fixed_top, turn)) {
+            transform(m_fixed_lines, m_fixed_arcs, fixed_x_origin, fixed_top, 1L, turn);
+            return;
+        }
+        to_doubles();
+    }
+    transform(m_lines, m_arcs, canvas.x_origin, top, canvas.scale, 360.);
+}
+
+Bounds Scene::bounds() const {
+    if (m_fixed) {
+        return bounds_of<std::int16_t, int>(m_fixed_lines, m_fixed_arcs, m_scale);
+    }
+    return bounds_of<double, double>(m_lines, m_arcs, 1.);
+}
+
+void Scene::cull(const Bounds& view) {
+    if (m_fixed) {
+        ::cull(m_fixed_lines, m_fixed_arcs, view, m_scale);
+    } else {
+        ::cull(m_lines, m_arcs, view, 1.);
+    }
+}
+
+void Scene::sort_by_color() {
+    if (m_fixed) {
+        ::sort_by_color(m_fixed_lines, m_fixed_arcs);
+    } else {
+        ::sort_by_color(m_lines, m_arcs);
+    }
+}
+
+std::size_t Scene::memory() const {
+    std::size_t total = 0;
+    if (m_fixed) {
+        each(m_fixed_lines, Bytes{total});
+        each(m_fixed_arcs, Bytes{total});
+    } else {
+        each(m_lines, Bytes{total});
+        each(m_arcs, Bytes{total});
+    }
+    return total;
+}
+
+void Scene::to_doubles() {
+    if (!m_fixed) {
+        return;
+    }
+    m_lines.x_start = ::to_doubles(m_fixed_lines.x_start, m_scale);
+    m_lines.x_end = ::to_doubles(m_fixed_lines.x_end, m_scale);
+    m_lines.y_start = ::to_doubles(m_fixed_lines.y_start, m_scale);
+    m_lines.y_end = ::to_doubles(m_fixed_lines.y_end, m_scale);
+    m_lines.color.swap(m_fixed_lines.color);
+    m_arcs.x_center = ::to_doubles(m_fixed_arcs.x_center, m_scale);
+    m_arcs.y_center = ::to_doubles(m_fixed_arcs.y_center, m_scale);
+    m_arcs.radius = ::to_doubles(m_fixed_arcs.radius, m_scale);
+    m_arcs.arc_start = ::to_doubles(m_fixed_arcs.arc_start, m_scale);
+    m_arcs.arc_extend = ::to_doubles(m_fixed_arcs.arc_extend, m_scale);
+    m_arcs.color.swap(m_fixed_arcs.color);
+    m_fixed_lines = FixedLines();
+    m_fixed_arcs = FixedArcs();
+    m_fixed = false;
+}
+
+Line to_image(const Line& line, const Canvas& canvas) {
+    const double top = canvas.height + canvas.y_origin * canvas.scale;
+    return Line((line.x_start - canvas.x_origin) * canvas.scale,
+                (line.x_end - canvas.x_origin) * canvas.scale,
+                top - line.y_start * canvas.scale,
+                top - line.y_end * canvas.scale,
+                line.color);
+}
+
+Arc to_image(const Arc& arc, const Canvas& canvas) {
+    const double top = canvas.height + canvas.y_origin * canvas.scale;
+    return Arc((arc.x_center - canvas.x_origin) * canvas.scale,
+               top - arc.y_center * canvas.scale,
+               arc.radius * canvas.scale,
+               360. - (arc.arc_start + arc.arc_extend), arc.arc_extend, arc.color);
+}
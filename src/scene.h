@@ -0,0 +1,168 @@
+#ifndef SCENE__H_
+#define SCENE__H_
+
+#include "plot.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Axis-aligned box, inclusive on every side.  An empty box has
+// x_min > x_max.
+struct Bounds {
+    Bounds();
+    Bounds(double x0, double y0, double x1, double y1);
+
+    bool empty() const { return x_min > x_max || y_min > y_max; }
+
+    // Grows the box to hold line, or the full circle of arc.
+    void include(const Line& line);
+    void include(const Arc& arc);
+
+    double x_min;
+    double y_min;
+    double x_max;
+    double y_max;
+};
+
+// An image of width x height pixels, and where a plot lands on it: plot
+// point (x, y) is drawn at pixel ((x - x_origin) * scale,
+// height - (y - y_origin) * scale), since y points up in a plot and down in
+// an image, and radii grow by scale.  The default is the plot as it is, one
+// unit per pixel with (0, 0) at the bottom left.
+struct Canvas {
+    // The largest width or height of an image.
+    static const int MAX_SIDE = 1 << 15;
+
+    Canvas(int width, int height, double x_origin = 0, double y_origin = 0, double scale = 1);
+
+    // A canvas showing all of bounds, centered.  A width or height of 0 is
+    // sized to bounds at scale.  If both are given, scale is replaced by the
+    // largest one that fits bounds in, unless a side of 1 leaves no room for
+    // more than the center of bounds at any scale.  A side that would be
+    // over MAX_SIDE comes out as MAX_SIDE + 1, so the canvas is not valid().
+    static Canvas fit(const Bounds& bounds, int width, int height, double scale = 1);
+
+    // Whether width and height are both in [1, MAX_SIDE], the origin is
+    // finite and the scale finite and positive.
+    bool valid() const;
+
+    int width;
+    int height;
+    double x_origin;
+    double y_origin;
+    double scale;
+};
+
+// Columns of the lines or arcs of a Scene, all of the same length.
+template<typename T>
+struct LineColumns {
+    std::vector<T> x_start;
+    std::vector<T> x_end;
+    std::vector<T> y_start;
+    std::vector<T> y_end;
+    std::vector<Color> color;
+};
+
+template<typename T>
+struct ArcColumns {
+    std::vector<T> x_center;
+    std::vector<T> y_center;
+    std::vector<T> radius;
+    std::vector<T> arc_start;
+    std::vector<T> arc_extend;
+    std::vector<Color> color;
+};
+
+// The primitives of a plot, stored column by column: one array per field of
+// Line and Arc, and one byte per color.  Line and Arc remain the per-primitive
+// view; add() scatters one into the columns and line()/arc() gather it back.
+//
+// Bulk passes read and write only the columns they need, in contiguous
+// branch-free loops that the compiler can vectorise.
+// Lines and arcs each keep their insertion order, which is the drawing order,
+// until sort_by_color() is called.
+//
+// A scene constructed with a scale stores every value v as the 16-bit integer
+// v * scale (fixed point), a quarter of the memory of doubles.  add() checks
+// each value: as soon as one is not an exact multiple of 1 / scale within
+// +-32767 / scale, the whole scene converts itself to doubles, so nothing is
+// ever lost.  line() and arc() return the same doubles either way.
+class Scene {
+public:
+    typedef LineColumns<double> Lines;
+    typedef ArcColumns<double> Arcs;
+    typedef LineColumns<std::int16_t> FixedLines;
+    typedef ArcColumns<std::int16_t> FixedArcs;
+
+    // Stores doubles.
+    Scene();
+    // Stores multiples of 1 / scale in fixed point while they fit; scale > 0.
+    explicit Scene(int scale);
+
+    void add(const Line& line);
+    void add(const Arc& arc);
+    // Appends all primitives of other, keeping their order.
+    void append(const Scene& other);
+    void reserve(std::size_t lines, std::size_t arcs);
+    // Replaces all primitives with the given columns, each of which must be
+    // as long as its color column.  The fixed-point form needs scale() != 0.
+    void assign(Lines lines, Arcs arcs);
+    void assign(FixedLines lines, FixedArcs arcs);
+    // Removes all primitives; a fixed-point scene that fell back to doubles
+    // goes back to fixed point.
+    void clear();
+
+    std::size_t line_count() const;
+    std::size_t arc_count() const;
+    Line line(std::size_t i) const;
+    Arc arc(std::size_t i) const;
+
+    // True while values are held in fixed point, i.e. fixed_lines() and
+    // fixed_arcs() are the columns, in units of 1 / scale().  Otherwise
+    // lines() and arcs() are.
+    bool fixed() const { return m_fixed; }
+    int scale() const { return m_scale; }
+    const Lines& lines() const { return m_lines; }
+    const Arcs& arcs() const { return m_arcs; }
+    const FixedLines& fixed_lines() const { return m_fixed_lines; }
+    const FixedArcs& fixed_arcs() const { return m_fixed_arcs; }
+
+    // Moves the scene from plot coordinates onto canvas, in one pass over
+    // each column.  The vertical mirror re-expresses arc angles so that each
+    // arc covers the same points with angles measured in the mirrored frame.
+    // A fixed-point scene stays fixed when the canvas keeps one unit per
+    // pixel and every result fits.
+    void to_image(const Canvas& canvas);
+
+    // Smallest box holding every line and the full circle of every arc.
+    Bounds bounds() const;
+
+    // Drops the primitives whose box (as in bounds()) misses view.  Those
+    // left keep their order.
+    void cull(const Bounds& view);
+
+    // Stably groups lines and arcs by color, in the order of enum Color, so
+    // that a renderer changes pens at most once per color.  Primitives of
+    // different colors no longer overdraw each other in file order.
+    void sort_by_color();
+
+    // Bytes held by the columns, not counting spare capacity.
+    std::size_t memory() const;
+
+private:
+    void to_doubles();
+
+    int m_scale;        // 0 for a scene of doubles
+    bool m_fixed;       // values are in m_fixed_lines and m_fixed_arcs
+    Lines m_lines;
+    Arcs m_arcs;
+    FixedLines m_fixed_lines;
+    FixedArcs m_fixed_arcs;
+};
+
+// The per-primitive form of Scene::to_image(), for primitives that are not
+// stored, such as those produced by PlotStream.
+Line to_image(const Line& line, const Canvas& canvas);
+Arc to_image(const Arc& arc, const Canvas& canvas);
+
+#endif // SCENE__H_
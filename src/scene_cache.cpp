@@ -0,0 +1,282 @@
+#include "scene_cache.h"
+#include "mapped_file.h"
+#include "scene.h"
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char MAGIC[8] = {'P', 'P', 'C', 'S', 'C', 'E', 'N', 'E'};
+const std::uint32_t VERSION = 1;
+const std::uint32_t ENDIAN_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;    // ENDIAN_MARK as written by the producer
+    std::uint64_t source_size;
+    std::int64_t source_sec;     // modification time of the source
+    std::int64_t source_nsec;
+    std::int32_t scale;          // Scene::scale()
+    std::uint32_t fixed;         // columns are int16 rather than double
+    std::uint64_t lines;
+    std::uint64_t arcs;
+    std::uint64_t path_size;
+};
+
+// Identity of a plot file as recorded in its entry.
+struct Source {
+    std::string path;
+    std::uint64_t size;
+    std::int64_t sec;
+    std::int64_t nsec;
+};
+
+bool identify(const std::string& filename, Source& source) {
+    char path[PATH_MAX];
+    struct stat st;
+    if (!::realpath(filename.c_str(), path) || ::stat(path, &st) != 0 ||
+        !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    source.path = path;
+    source.size = static_cast<std::uint64_t>(st.st_size);
+    source.sec = st.st_mtim.tv_sec;
+    source.nsec = st.st_mtim.tv_nsec;
+    return true;
+}
+
+std::size_t padded(std::size_t size) {
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+// directory/<FNV-1a of path>.scene
+std::string entry_name(const std::string& directory, const std::string& path) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (const char c : path) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.scene",
+                  static_cast<unsigned long long>(hash));
+    return directory + name;
+}
+
+// Creates directory and any missing parents.
+bool make_directories(const std::string& directory) {
+    for (std::size_t slash = directory.find('/', 1); ;
+         slash = directory.find('/', slash + 1)) {
+        const std::string prefix = directory.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Appends size bytes and zero padding up to the next multiple of 8.
+void put(std::string& out, const void* data, std::size_t size) {
+    out.append(static_cast<const char*>(data), size);
+    out.append(padded(size) - size, '\0');
+}
+
+template<typename T>
+void put(std::string& out, const std::vector<T>& column) {
+    put(out, column.data(), column.size() * sizeof(T));
+}
+
+template<typename T>
+void put(std::string& out, const LineColumns<T>& lines, const ArcColumns<T>& arcs) {
+    put(out, lines.x_start);
+    put(out, lines.x_end);
+    put(out, lines.y_start);
+    put(out, lines.y_end);
+    put(out, arcs.x_center);
+    put(out, arcs.y_center);
+    put(out, arcs.radius);
+    put(out, arcs.arc_start);
+    put(out, arcs.arc_extend);
+    put(out, lines.color);
+    put(out, arcs.color);
+}
+
+// Bytes of the blocks after the path.
+std::size_t blocks_size(std::size_t value, std::uint64_t lines, std::uint64_t arcs) {
+    return 4 * padded(lines * value) + 5 * padded(arcs * value) +
+           padded(lines) + padded(arcs);
+}
+
+template<typename T>
+void get(const char*& in, std::vector<T>& column, std::size_t count) {
+    column.resize(count);
+    std::memcpy(column.data(), in, count * sizeof(T));
+    in += padded(count * sizeof(T));
+}
+
+template<typename T>
+void get(const char* in, const Header& header,
+         LineColumns<T>& lines, ArcColumns<T>& arcs) {
+    get(in, lines.x_start, header.lines);
+    get(in, lines.x_end, header.lines);
+    get(in, lines.y_start, header.lines);
+    get(in, lines.y_end, header.lines);
+    get(in, arcs.x_center, header.arcs);
+    get(in, arcs.y_center, header.arcs);
+    get(in, arcs.radius, header.arcs);
+    get(in, arcs.arc_start, header.arcs);
+    get(in, arcs.arc_extend, header.arcs);
+    get(in, lines.color, header.lines);
+    get(in, arcs.color, header.arcs);
+}
+
+bool valid_colors(const std::vector<Color>& colors) {
+    bool ok = true;
+    for (const Color color : colors) {
+        ok &= color <= Color::White;
+    }
+    return ok;
+}
+
+} // namespace
+
+SceneCache::SceneCache(const std::string& directory)
+    : m_directory(directory)
+    {}
+
+std::string SceneCache::default_directory() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg == '/') {
+        return std::string(xdg) + "/level4";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home == '/') {
+        return std::string(home) + "/.cache/level4";
+    }
+    return std::string();
+}
+
+bool SceneCache::load(const std::string& filename, Scene& scene) const {
+    Source source;
+    if (m_directory.empty() || !identify(filename, source)) {
+        return false;
+    }
+    MappedFile file;
+    if (!file.open(entry_name(m_directory, source.path), false) ||
+        file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION || header.byte_order != ENDIAN_MARK ||
+        header.source_size != source.size || header.source_sec != source.sec ||
+        header.source_nsec != source.nsec || header.scale != scene.scale() ||
+        header.fixed > 1 || (header.fixed && header.scale == 0) ||
+        header.path_size != source.path.size()) {
+        return false;
+    }
+    // Counts come from the file: bound them before any arithmetic on them.
+    const std::uint64_t limit = file.size();
+    if (header.lines > limit || header.arcs > limit ||
+        file.size() != sizeof(Header) + padded(header.path_size) +
+                       blocks_size(header.fixed ? sizeof(std::int16_t) : sizeof(double),
+                                   header.lines, header.arcs) ||
+        source.path.compare(0, std::string::npos,
+                            file.data() + sizeof(Header), header.path_size) != 0) {
+        return false;
+    }
+
+    const char* blocks = file.data() + sizeof(Header) + padded(header.path_size);
+    if (header.fixed) {
+        Scene::FixedLines lines;
+        Scene::FixedArcs arcs;
+        get(blocks, header, lines, arcs);
+        if (!valid_colors(lines.color) || !valid_colors(arcs.color)) {
+            return false;
+        }
+        scene.assign(std::move(lines), std::move(arcs));
+    } else {
+        Scene::Lines lines;
+        Scene::Arcs arcs;
+        get(blocks, header, lines, arcs);
+        if (!valid_colors(lines.color) || !valid_colors(arcs.color)) {
+            return false;
+        }
+        scene.assign(std::move(lines), std::move(arcs));
+    }
+    return true;
+}
+
+bool SceneCache::store(const std::string& filename, const Scene& scene) const {
+    Source source;
+    if (m_directory.empty() || !identify(filename, source) ||
+        !make_directories(m_directory)) {
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = ENDIAN_MARK;
+    header.source_size = source.size;
+    header.source_sec = source.sec;
+    header.source_nsec = source.nsec;
+    header.scale = scene.scale();
+    header.fixed = scene.fixed();
+    header.lines = scene.line_count();
+    header.arcs = scene.arc_count();
+    header.path_size = source.path.size();
+
+    std::string out;
+    out.reserve(sizeof(Header) + padded(source.path.size()) +
+                blocks_size(scene.fixed() ? sizeof(std::int16_t) : sizeof(double),
+                            header.lines, header.arcs));
+    put(out, &header, sizeof(header));
+    put(out, source.path.data(), source.path.size());
+    if (scene.fixed()) {
+        put(out, scene.fixed_lines(), scene.fixed_arcs());
+    } else {
+        put(out, scene.lines(), scene.arcs());
+    }
+
+    const std::string entry = entry_name(m_directory, source.path);
+    const std::string temp = entry + "." + std::to_string(::getpid()) + ".tmp";
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    const bool written = write_all(fd, out.data(), out.size());
+    if (::close(fd) != 0 || !written || ::rename(temp.c_str(), entry.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef SCENE_CACHE__H_
+#define SCENE_CACHE__H_
+
+#include <string>
+
+class Scene;
+
+// On-disk copies of parsed scenes, so that a plot file that has not changed
+// since its last run is loaded without parsing any XML.
+//
+// Each plot file has one entry in the cache directory, named after a hash of
+// its absolute path.  An entry records the path, size and modification time
+// of the file it was made from, and is only used while all three still match.
+//
+// An entry is a binary image of the Scene columns (version 1, native byte
+// order):
+//
+//     header          magic "PPCSCENE", version, byte order mark, source size
+//                     and mtime, scale, fixed flag, line and arc counts,
+//                     path size
+//     path            the absolute source path
+//     line columns    x_start, x_end, y_start, y_end
+//     arc columns     x_center, y_center, radius, arc_start, arc_extend
+//     colors          one byte per line, then one per arc
+//
+// Every block starts at a multiple of 8 bytes.  Values are doubles, or int16
+// in units of 1 / scale when the fixed flag is set.  Loading maps the entry
+// read-only and copies each column with a single memcpy.
+class SceneCache {
+public:
+    explicit SceneCache(const std::string& directory);
+
+    // $XDG_CACHE_HOME/level4, or ~/.cache/level4; empty if neither is known.
+    static std::string default_directory();
+
+    // Fills scene from the entry for filename, if there is a current one that
+    // was stored from a scene of the same scale().  Returns false otherwise,
+    // leaving scene untouched.
+    bool load(const std::string& filename, Scene& scene) const;
+
+    // Writes scene as the entry for filename, creating the directory if
+    // needed.  The entry is written beside its final name and renamed into
+    // place, so readers never see a partial one.  Returns false on failure,
+    // which only costs the next run a parse.
+    bool store(const std::string& filename, const Scene& scene) const;
+
+private:
+    std::string m_directory;
+};
+
+#endif // SCENE_CACHE__H_
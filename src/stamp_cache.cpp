@@ -0,0 +1,94 @@
+#include "stamp_cache.h"
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+// Bookkeeping of a stamp beyond its offsets: the list node and the index
+// entry, roughly.
+const std::size_t STAMP_OVERHEAD = 64;
+
+std::uint64_t stamp_key(int radius, const ArcSpan& span) {
+    return static_cast<std::uint64_t>(radius) << 32 |
+           static_cast<std::uint64_t>(span.start) << 16 |
+           static_cast<std::uint64_t>(span.extent);
+}
+
+std::size_t stamp_size(std::size_t offsets) {
+    return offsets * sizeof(Offset) + STAMP_OVERHEAD;
+}
+
+} // namespace
+
+const std::size_t StampCache::DEFAULT_BUDGET;
+const int StampCache::MAX_RADIUS;
+
+StampCache::StampCache(std::size_t budget)
+    : m_budget(budget)
+    , m_size(0)
+    , m_hits(0)
+    , m_misses(0)
+    {}
+
+void StampCache::draw(const Raster& raster, int x_center, int y_center, int radius,
+                      int start, int end, const Pixel& pixel) {
+    radius = std::abs(radius);
+    if (radius > MAX_RADIUS || m_budget == 0) {
+        draw_arc(raster, x_center, y_center, radius, start, end, pixel);
+        return;
+    }
+
+    const ArcSpan span = arc_span(start, end);
+    const std::uint64_t key = stamp_key(radius, span);
+    const auto found = m_index.find(key);
+    if (found != m_index.end()) {
+        ++m_hits;
+        m_stamps.splice(m_stamps.begin(), m_stamps, found->second);
+    } else {
+        ++m_misses;
+        if (!insert(key, radius, span)) {
+            draw_arc(raster, x_center, y_center, radius, start, end, pixel);
+            return;
+        }
+    }
+    const std::vector<Offset>& offsets = m_stamps.front().offsets;
+    draw_stamp(raster, x_center, y_center, offsets.data(), offsets.size(), radius, pixel);
+}
+
+bool StampCache::insert(std::uint64_t key, int radius, const ArcSpan& span) {
+    // The arc is drawn into a mask of its box, which is then read back row by
+    // row, so each pixel is listed once however many octants set it.
+    const int side = 2 * radius + 1;
+    std::vector<unsigned char> mask(static_cast<std::size_t>(side) * side);
+    const Raster raster(mask.data(), side, 1, side, side);
+    const Pixel set = {{1, 1, 1}};
+    draw_arc(raster, radius, radius, radius, span.start, span.start + span.extent, set);
+
+    Stamp stamp;
+    stamp.key = key;
+    for (int y = 0; y < side; ++y) {
+        const unsigned char* row = &mask[static_cast<std::size_t>(y) * side];
+        for (int x = 0; x < side; ++x) {
+            if (row[x]) {
+                const Offset offset = {static_cast<std::int16_t>(x - radius),
+                                       static_cast<std::int16_t>(y - radius)};
+                stamp.offsets.push_back(offset);
+            }
+        }
+    }
+    const std::size_t size = stamp_size(stamp.offsets.size());
+    if (size > m_budget) {
+        return false;
+    }
+
+    while (m_size + size > m_budget) {
+        const Stamp& last = m_stamps.back();
+        m_size -= stamp_size(last.offsets.size());
+        m_index.erase(last.key);
+        m_stamps.pop_back();
+    }
+    m_stamps.push_front(std::move(stamp));
+    m_index[key] = m_stamps.begin();
+    m_size += size;
+    return true;
+}
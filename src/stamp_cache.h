@@ -0,0 +1,61 @@
+#ifndef STAMP_CACHE__H_
+#define STAMP_CACHE__H_
+
+#include "raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Pre-rasterised arcs, for plots that draw the same arc at many centers.
+//
+// A stamp lists the offsets from the center of the pixels draw_arc() sets
+// for one radius and arc_span(), so arcs whose angles differ by whole turns
+// share one.  Arcs are always one pixel wide, so the width is not part of
+// the key.  Stamps are kept within a budget of bytes, dropping the least
+// recently used first.  Arcs with a radius over MAX_RADIUS are drawn
+// directly: they are rarely repeated and their stamps are large.
+//
+// Not thread safe; each thread needs its own cache.
+class StampCache {
+public:
+    static const std::size_t DEFAULT_BUDGET = 4 << 20;
+    static const int MAX_RADIUS = 256;
+
+    explicit StampCache(std::size_t budget = DEFAULT_BUDGET);
+
+    // Sets the pixels draw_arc() would.
+    void draw(const Raster& raster, int x_center, int y_center, int radius,
+              int start, int end, const Pixel& pixel);
+
+    // Arcs drawn from a cached stamp, and arcs whose stamp had to be
+    // rasterised first.  Arcs drawn directly count as neither.
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+
+    // Bytes held by the cached stamps.
+    std::size_t size() const { return m_size; }
+
+private:
+    StampCache(const StampCache&) = delete;
+    StampCache& operator=(const StampCache&) = delete;
+
+    struct Stamp {
+        std::uint64_t key;
+        std::vector<Offset> offsets;
+    };
+    typedef std::list<Stamp> Stamps;
+
+    // Rasterises the stamp for key, or returns false if it would not fit.
+    bool insert(std::uint64_t key, int radius, const ArcSpan& span);
+
+    std::size_t m_budget;
+    std::size_t m_size;
+    std::size_t m_hits;
+    std::size_t m_misses;
+    Stamps m_stamps;                    // most recently used first
+    std::unordered_map<std::uint64_t, Stamps::iterator> m_index;
+};
+
+#endif // STAMP_CACHE__H_
@@ -0,0 +1,315 @@
+// Checks that draw_arc() sets exactly the pixels of a plain reference: the
+// midpoint circle of the radius, all eight octants of it, keeping the pixels
+// whose direction from the center lies within the arc's angles.  The arcs
+// are those of a plot on canvases of several sizes, and seeded random ones
+// with reversed, negative, empty and longer than 360 degree spans, spans
+// ending on multiples of 45 degrees, radii of 0 and below, and centers
+// anywhere from inside the image to far beyond its edges.  Each set is drawn
+// over the whole image, through tile windows of it, and into tiles with
+// storage of their own, on one- and three-channel images from 1x1 up.
+//
+// Usage: arc_raster_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "raster.h"
+#include "scene.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Arcs {
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<int> radius;
+    std::vector<int> start;
+    std::vector<int> end;
+    std::vector<Pixel> pixels;
+
+    void add(int cx, int cy, int r, int from, int to) {
+        // Arcs overlap, so each gets a value of its own to check the drawing
+        // order too.
+        const unsigned char value = static_cast<unsigned char>(pixels.size() % 251 + 1);
+        const Pixel pixel = {{value, static_cast<unsigned char>(value ^ 0x55),
+                              static_cast<unsigned char>(value ^ 0xaa)}};
+        x.push_back(cx);
+        y.push_back(cy);
+        radius.push_back(r);
+        start.push_back(from);
+        end.push_back(to);
+        pixels.push_back(pixel);
+    }
+
+    std::size_t size() const { return pixels.size(); }
+};
+
+// The arcs of scene on canvas, with the integer geometry render.cpp gives
+// them: centers rounded from floats, radii truncated, angles rounded.
+Arcs plot_arcs(const Scene& plot, const Canvas& canvas) {
+    Scene scene = plot;
+    scene.to_image(canvas);
+    Arcs arcs;
+    for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+        const Arc arc = scene.arc(i);
+        arcs.add(static_cast<int>(std::lrint(static_cast<float>(arc.x_center))),
+                 static_cast<int>(std::lrint(static_cast<float>(arc.y_center))),
+                 static_cast<int>(arc.radius),
+                 static_cast<int>(std::lrint(arc.arc_start)),
+                 static_cast<int>(std::lrint(arc.arc_start + arc.arc_extend)));
+    }
+    return arcs;
+}
+
+Arcs random_arcs(std::mt19937& random, int width, int height) {
+    const int side = std::max(width, height);
+    const int reach = 2 * side + 10;
+    auto any_x = [&]() { return std::uniform_int_distribution<int>(-reach, width + reach)(random); };
+    auto any_y = [&]() { return std::uniform_int_distribution<int>(-reach, height + reach)(random); };
+    auto radius = [&]() { return std::uniform_int_distribution<int>(-side - 5, 2 * side + 5)(random); };
+    auto angle = [&]() { return std::uniform_int_distribution<int>(-1000, 1000)(random); };
+    auto eighth = [&]() { return 45 * std::uniform_int_distribution<int>(-16, 16)(random); };
+    auto inside_x = [&]() { return std::uniform_int_distribution<int>(0, width - 1)(random); };
+    auto inside_y = [&]() { return std::uniform_int_distribution<int>(0, height - 1)(random); };
+
+    Arcs arcs;
+    for (int i = 0; i < 40; ++i) {
+        const int x = any_x();
+        const int y = any_y();
+        const int from = angle();
+        // Any span, reversed, empty, and of one turn or more.
+        arcs.add(x, y, radius(), from, angle());
+        arcs.add(any_x(), any_y(), radius(), from, from);
+        arcs.add(any_x(), any_y(), radius(), from, from + 360 + i % 3);
+        arcs.add(any_x(), any_y(), radius(), from + 359, from);
+        // Starting or ending on multiples of 45 degrees, where pixels lie
+        // exactly on the boundary; centered in the image so that those
+        // pixels are mostly in it.
+        const int on = eighth();
+        const int span = std::uniform_int_distribution<int>(1, 179)(random);
+        auto near = [&]() { return std::uniform_int_distribution<int>(1, side / 2 + 1)(random); };
+        arcs.add(x, y, radius(), eighth(), eighth());
+        arcs.add(inside_x(), inside_y(), near(), on, on + span);
+        arcs.add(inside_x(), inside_y(), near(), on, on - span);
+        // Points, and the circles through the image corners.
+        arcs.add(inside_x(), inside_y(), i % 3 - 1, from, angle());
+        arcs.add(-1, height, side + i % 5, from, from + 90);
+    }
+    // Centers far away, with radii that reach back into the image.
+    const int far = 1 << 14;
+    arcs.add(-far, height / 2, far + width / 2, -30, 30);
+    arcs.add(width / 2, height + far, far, 180, 360);
+    arcs.add(width + far, -far, far * 3 / 2, 90, 180);
+    return arcs;
+}
+
+// The direction of offset (x, y) in degrees, in [0, 360).  Whole-degree
+// directions other than multiples of 45 pass through no pixel, and the
+// pixels of a reasonable circle come nowhere near as close to them as
+// atan2() is exact.
+double direction(int x, int y) {
+    if (y == 0) {
+        return x >= 0 ? 0 : 180;
+    }
+    if (x == 0) {
+        return y > 0 ? 90 : 270;
+    }
+    if (x == y) {
+        return x > 0 ? 45 : 225;
+    }
+    if (x == -y) {
+        return x < 0 ? 135 : 315;
+    }
+    const double degrees = std::atan2(y, x) * 180 / std::acos(-1.0);
+    return degrees < 0 ? degrees + 360 : degrees;
+}
+
+// cv::ellipse()'s angle conventions.
+bool within(double direction, int start, int end) {
+    if (start > end) {
+        std::swap(start, end);
+    }
+    if (static_cast<long long>(end) - start >= 360) {
+        return true;
+    }
+    const int from = (start % 360 + 360) % 360;
+    double after = direction - from;
+    if (after < 0) {
+        after += 360;
+    }
+    return after <= end - start;
+}
+
+// Offsets of the midpoint circle of radius r, octant by octant.
+std::vector<Offset> circle(int r) {
+    std::vector<Offset> offsets;
+    int x = r;
+    int y = 0;
+    int d = 1 - r;
+    while (x >= y) {
+        const int points[8][2] = {{x, y}, {y, x}, {-y, x}, {-x, y},
+                                  {-x, -y}, {-y, -x}, {y, -x}, {x, -y}};
+        for (const auto& point : points) {
+            offsets.push_back(Offset{static_cast<std::int16_t>(point[0]),
+                                     static_cast<std::int16_t>(point[1])});
+        }
+        ++y;
+        if (d < 0) {
+            d += 2 * y + 1;
+        } else {
+            --x;
+            d += 2 * (y - x) + 1;
+        }
+    }
+    return offsets;
+}
+
+cv::Mat reference(const Arcs& arcs, int width, int height, int channels) {
+    cv::Mat image(height, width, CV_8UC(channels), cv::Scalar::all(0));
+    for (std::size_t i = 0; i < arcs.size(); ++i) {
+        const int r = std::abs(arcs.radius[i]);
+        // Circles whose box misses the image are not walked.
+        if (arcs.x[i] + static_cast<long long>(r) < 0 || arcs.x[i] - r >= width ||
+            arcs.y[i] + static_cast<long long>(r) < 0 || arcs.y[i] - r >= height) {
+            continue;
+        }
+        for (const Offset& offset : circle(r)) {
+            const long long px = static_cast<long long>(arcs.x[i]) + offset.x;
+            const long long py = static_cast<long long>(arcs.y[i]) + offset.y;
+            // A circle of radius 0 is its center, whatever the angles.
+            if (px < 0 || px >= width || py < 0 || py >= height ||
+                (r > 0 && !within(direction(offset.x, offset.y), arcs.start[i], arcs.end[i]))) {
+                continue;
+            }
+            std::memcpy(image.ptr(static_cast<int>(py)) + px * channels, arcs.pixels[i].value,
+                        channels);
+        }
+    }
+    return image;
+}
+
+void draw(const Raster& raster, const Arcs& arcs) {
+    for (std::size_t i = 0; i < arcs.size(); ++i) {
+        draw_arc(raster, arcs.x[i], arcs.y[i], arcs.radius[i], arcs.start[i], arcs.end[i],
+                 arcs.pixels[i]);
+    }
+}
+
+bool same(const cv::Mat& a, const cv::Mat& b) {
+    const std::size_t row = a.cols * a.elemSize();
+    for (int y = 0; y < a.rows; ++y) {
+        if (std::memcmp(a.ptr(y), b.ptr(y), row) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Draws arcs every way onto a width x height image and counts the ways that
+// differ from the reference.
+int check(const char* what, const Arcs& arcs, int width, int height) {
+    int failures = 0;
+    for (int channels = 1; channels <= 3; channels += 2) {
+        const cv::Mat expected = reference(arcs, width, height, channels);
+
+        cv::Mat whole(height, width, CV_8UC(channels), cv::Scalar::all(0));
+        draw(Raster(whole.data, whole.step, channels, width, height), arcs);
+        if (!same(whole, expected)) {
+            std::fprintf(stderr, "FAIL: %s, %dx%dx%d, whole image\n", what, width, height, channels);
+            ++failures;
+        }
+
+        const int tiles[] = {1, 7, 64, 256};
+        for (const int tile : tiles) {
+            // Every arc in reach is walked for every tile, so small tiles
+            // are only tried on small images.
+            const long count = static_cast<long>((width + tile - 1) / tile) *
+                               ((height + tile - 1) / tile);
+            if ((tile > 1 && tile >= std::max(width, height)) || count > 1 << 8) {
+                continue;
+            }
+
+            cv::Mat windows(height, width, CV_8UC(channels), cv::Scalar::all(0));
+            cv::Mat copies(height, width, CV_8UC(channels), cv::Scalar::all(0));
+            const Raster image(windows.data, windows.step, channels, width, height);
+            std::vector<unsigned char> storage(static_cast<std::size_t>(tile) * tile * channels);
+            for (int y0 = 0; y0 < height; y0 += tile) {
+                for (int x0 = 0; x0 < width; x0 += tile) {
+                    const int x1 = std::min(x0 + tile, width) - 1;
+                    const int y1 = std::min(y0 + tile, height) - 1;
+                    draw(image.window(x0, y0, x1, y1), arcs);
+
+                    const std::size_t step = static_cast<std::size_t>(tile) * channels;
+                    std::fill(storage.begin(), storage.end(), 0);
+                    draw(Raster(storage.data(), step, channels, width, height, x0, y0, x1, y1),
+                         arcs);
+                    for (int y = y0; y <= y1; ++y) {
+                        std::memcpy(copies.ptr(y) + x0 * channels, &storage[(y - y0) * step],
+                                    (x1 - x0 + 1) * channels);
+                    }
+                }
+            }
+            if (!same(windows, expected)) {
+                std::fprintf(stderr, "FAIL: %s, %dx%dx%d, %d pixel windows\n",
+                             what, width, height, channels, tile);
+                ++failures;
+            }
+            if (!same(copies, expected)) {
+                std::fprintf(stderr, "FAIL: %s, %dx%dx%d, %d pixel tiles\n",
+                             what, width, height, channels, tile);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    if (plot.arc_count() == 0) {
+        std::fprintf(stderr, "No arcs in: %s\n", argv[1]);
+        return 2;
+    }
+
+    const int sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {2, 3}, {17, 5}, {100, 100},
+                            {333, 217}, {1000, 1000}};
+    std::mt19937 random(20240601);
+    int failures = 0;
+    for (const auto& size : sizes) {
+        const int width = size[0];
+        const int height = size[1];
+        // The plot fitted to the canvas, and at its own scale with the origin
+        // in the middle, which for small canvases leaves most of it outside.
+        failures += check("plot fitted", plot_arcs(plot, Canvas::fit(plot.bounds(), width, height)),
+                          width, height);
+        failures += check("plot", plot_arcs(plot, Canvas(width, height, -width / 2, -height / 2)),
+                          width, height);
+        failures += check("random", random_arcs(random, width, height), width, height);
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("draw_arc() matches the midpoint circle reference\n");
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Checks interned element names on plotMe.xml: with parse_intern_names,
+// first_node_atom() and next_sibling_atom() must find the same nodes as
+// first_node() and next_sibling() by name, under every element, for every
+// name in the document and for names that were never interned.
+//
+// Usage: atom_test <plot.xml>
+
+#include "mapped_file.h"
+#include "rapidxml.hpp"
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef rapidxml::xml_node<> Node;
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& name) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s: \"%s\"\n", what, name.c_str());
+    }
+}
+
+void collect(const Node* node, std::vector<const Node*>& elements, std::set<std::string>& names) {
+    for (const Node* child = node->first_node(); child; child = child->next_sibling()) {
+        if (child->type() == rapidxml::node_element) {
+            elements.push_back(child);
+            names.insert(std::string(child->name(), child->name_size()));
+            collect(child, elements, names);
+        }
+    }
+}
+
+// Compares the atom lookups for name under parent with the lookups by name.
+void compare(const Node* parent, const std::string& name, const char* atom) {
+    const Node* by_name = parent->first_node(name.data(), name.size());
+    const Node* by_atom = parent->first_node_atom(atom);
+    check(by_atom == by_name, "first_node_atom() differs from first_node()", name);
+    while (by_name && by_atom == by_name) {
+        by_name = by_name->next_sibling(name.data(), name.size());
+        by_atom = by_atom->next_sibling_atom(atom);
+        check(by_atom == by_name, "next_sibling_atom() differs from next_sibling()", name);
+    }
+}
+
+template<int Flags>
+void check_document(const std::string& text) {
+    std::vector<char> buffer(text.begin(), text.end());
+    buffer.push_back(0);
+    rapidxml::xml_document<> doc;
+    doc.parse<Flags | rapidxml::parse_intern_names>(buffer.data());
+
+    std::vector<const Node*> elements;
+    std::set<std::string> names;
+    collect(&doc, elements, names);
+    check(names.size() > 1, "too few element names", "");
+
+    // One copy of each name, shared by every element with it.
+    std::set<const char*> atoms;
+    for (const std::string& name : names) {
+        const char* atom = doc.atom(name.data(), name.size());
+        check(atom && std::string(atom) == name, "atom() does not give the name", name);
+        check(atoms.insert(atom).second, "atom() shared between names", name);
+        const std::string longer = name + "Tail";
+        check(doc.atom(longer.data(), name.size()) == atom, "atom() reads past name_size", name);
+        check(doc.atom(name.c_str()) == atom, "atom() of a zero terminated name differs", name);
+    }
+    for (const Node* element : elements) {
+        const std::string name(element->name(), element->name_size());
+        check(element->name() == doc.atom(name.c_str()), "element name is not its atom", name);
+    }
+
+    // Never interned: prefixes, extensions, other case, attribute-like.
+    const char* const others[] = {"Nope", "Lin", "Line2", "line", "LINE", "XStartX", "xmlns:xsi", "ppcplot"};
+    for (const char* other : others) {
+        if (names.count(other) == 0) {
+            check(doc.atom(other) == 0, "atom() of a name never parsed", other);
+        }
+    }
+
+    std::vector<const Node*> parents(1, &doc);
+    parents.insert(parents.end(), elements.begin(), elements.end());
+    for (const Node* parent : parents) {
+        for (const std::string& name : names) {
+            compare(parent, name, doc.atom(name.data(), name.size()));
+        }
+        for (const char* other : others) {
+            compare(parent, other, doc.atom(other));
+        }
+    }
+
+    // Interned names go with the document.
+    doc.reset();
+    check(doc.atom("Line") == 0, "atom() after reset()", "Line");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const std::string text(file.data(), file.size());
+
+    check_document<0>(text);
+    check_document<rapidxml::parse_non_destructive>(text);
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("atom lookups match name lookups\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Checks the child index of xml_node against plain walks of the children:
+// first_node_indexed() must find what first_node() finds and child_count()
+// must count the children, for every child name of every element of
+// plotMe.xml, and through seeded random appends, prepends, inserts, removals
+// and renames (including through xml_base) between queries.
+//
+// Usage: child_index_test <plot.xml>
+
+#include "mapped_file.h"
+#include "rapidxml.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef rapidxml::xml_node<> Node;
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+std::size_t walk_count(const Node* node) {
+    std::size_t count = 0;
+    for (const Node* child = node->first_node(); child; child = child->next_sibling()) {
+        ++count;
+    }
+    return count;
+}
+
+void compare(const Node* node, const std::string& name, const std::string& detail) {
+    check(node->first_node_indexed(name.data(), name.size()) ==
+          node->first_node(name.data(), name.size()),
+          "first_node_indexed() differs from first_node()", name + ", " + detail);
+}
+
+void check_plot(const std::string& text) {
+    std::vector<char> buffer(text.begin(), text.end());
+    buffer.push_back(0);
+    rapidxml::xml_document<> doc;
+    doc.parse<0>(buffer.data());
+
+    std::vector<const Node*> nodes(1, &doc);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        for (const Node* child = nodes[i]->first_node(); child; child = child->next_sibling()) {
+            nodes.push_back(child);
+        }
+    }
+    const char* const missing[] = {"Nope", "Lin", "Line2", "line", ""};
+    for (const Node* node : nodes) {
+        check(node->child_count() == walk_count(node), "child_count() differs", "plot");
+        check(node->has_child_index(), "no index after child_count()", "plot");
+        for (const Node* child = node->first_node(); child; child = child->next_sibling()) {
+            compare(node, std::string(child->name(), child->name_size()), "plot");
+        }
+        for (const char* name : missing) {
+            compare(node, name, "plot");
+        }
+    }
+}
+
+void check_edits(unsigned seed) {
+    std::mt19937 random(seed);
+    auto below = [&](int n) { return std::uniform_int_distribution<int>(0, n - 1)(random); };
+    const char* const names[] = {"a", "b", "c", "d", "e", "f"};
+    const int name_count = 6;
+
+    rapidxml::xml_document<> doc;
+    Node* root = doc.allocate_node(rapidxml::node_element, "root");
+    doc.append_node(root);
+
+    auto nth = [&](int n) {
+        Node* child = root->first_node();
+        while (n-- > 0) {
+            child = child->next_sibling();
+        }
+        return child;
+    };
+    auto fresh = [&]() { return doc.allocate_node(rapidxml::node_element, names[below(name_count)]); };
+
+    for (int step = 0; step < 3000; ++step) {
+        const int size = static_cast<int>(walk_count(root));
+        const std::string detail = "seed " + std::to_string(seed) + ", step " + std::to_string(step);
+        const bool indexed = root->has_child_index();
+        bool kept = true;   // whether the edit keeps an index current
+        switch (below(9)) {
+        case 0:
+            root->append_node(fresh());
+            break;
+        case 1:
+            root->prepend_node(fresh());
+            break;
+        case 2: {
+            // Inserting before the first child or at the end prepends or appends.
+            Node* where = size ? nth(below(size + 1)) : 0;
+            kept = where == 0 || where == root->first_node();
+            root->insert_node(where, fresh());
+            break;
+        }
+        case 3:
+            if (size) {
+                root->remove_node(nth(below(size)));
+            }
+            kept = size == 0;
+            break;
+        case 4:
+            if (size) {
+                below(2) ? root->remove_first_node() : root->remove_last_node();
+            }
+            kept = size == 0;
+            break;
+        case 5:
+            if (size) {
+                nth(below(size))->name(names[below(name_count)]);
+            }
+            kept = size == 0;
+            break;
+        case 6:
+            if (size) {
+                rapidxml::xml_base<>* base = nth(below(size));
+                const char* name = names[below(name_count)];
+                base->name(name, 1);
+            }
+            kept = size == 0;
+            break;
+        case 7:
+            if (below(20) == 0) {
+                root->remove_all_nodes();
+                kept = false;
+            }
+            break;
+        default:
+            break;
+        }
+        if (indexed && kept) {
+            check(root->has_child_index(), "index dropped by an edit that keeps it", detail);
+        }
+        if (!kept) {
+            check(!root->has_child_index(), "index kept by an edit that invalidates it", detail);
+        }
+
+        if (below(3) == 0) {
+            check(root->child_count() == walk_count(root), "child_count() differs", detail);
+        }
+        for (int i = 0; i < name_count; ++i) {
+            if (below(2)) {
+                compare(root, names[i], detail);
+            }
+        }
+        compare(root, "g", detail);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    check_plot(std::string(file.data(), file.size()));
+    for (unsigned seed = 1; seed <= 50; ++seed) {
+        check_edits(seed);
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("indexed lookups match walks of the children\n");
+    return 0;
+}
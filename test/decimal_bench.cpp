@@ -0,0 +1,96 @@
+// Times parse_decimal() against std::stod() on the field values of a plot.
+//
+// Usage: decimal_bench <plot.xml> [rounds]
+
+#include "decimal.h"
+#include "mapped_file.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+typedef std::pair<const char*, const char*> Range;
+
+// The text of every element that holds nothing but a number.
+std::vector<Range> field_values(const char* text, std::size_t size) {
+    std::vector<Range> values;
+    const char* const end = text + size;
+    for (const char* p = text; p < end; ++p) {
+        if (*p != '>') {
+            continue;
+        }
+        const char* first = p + 1;
+        const char* last = first;
+        while (last < end && *last != '<') {
+            ++last;
+        }
+        double number;
+        if (last < end && last[1] == '/' && parse_decimal(first, last, number)) {
+            values.push_back(Range(first, last));
+        }
+        p = last - 1;
+    }
+    return values;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml> [rounds]\n", argv[0]);
+        return 2;
+    }
+    const long rounds = argc > 2 ? std::atol(argv[2]) : 2000;
+
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const std::vector<Range> values = field_values(file.data(), file.size());
+    std::vector<std::string> strings;
+    for (const Range& value : values) {
+        strings.push_back(std::string(value.first, value.second));
+    }
+    if (values.empty()) {
+        std::fprintf(stderr, "No numbers in: %s\n", argv[1]);
+        return 2;
+    }
+
+    // The sums keep the parses from being optimised away, and show both
+    // read the same numbers.
+    double decimal_sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long round = 0; round < rounds; ++round) {
+        for (const Range& value : values) {
+            double number = 0;
+            parse_decimal(value.first, value.second, number);
+            decimal_sum += number;
+        }
+    }
+    const double decimal_time = seconds_since(start);
+
+    double stod_sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (long round = 0; round < rounds; ++round) {
+        for (const std::string& value : strings) {
+            stod_sum += std::stod(value);
+        }
+    }
+    const double stod_time = seconds_since(start);
+
+    const double parses = static_cast<double>(rounds) * values.size();
+    std::printf("%zu values x %ld rounds\n", values.size(), rounds);
+    std::printf("parse_decimal: %6.1f ns/value (sum %.17g)\n", decimal_time / parses * 1e9, decimal_sum);
+    std::printf("std::stod:     %6.1f ns/value (sum %.17g)\n", stod_time / parses * 1e9, stod_sum);
+    std::printf("speedup:       %6.2fx\n", stod_time / decimal_time);
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Checks that parse_decimal() accepts exactly the numbers strtod_l() in the
+// C locale reads whole, and gives them bit for bit the same value: boundary
+// cases of the exact path, then seeded random numbers of every shape.
+//
+// Usage: decimal_test [count]
+
+#include "decimal.h"
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+locale_t c_locale;
+
+// Reports whether parse_decimal() and strtod_l() agree on text.  Only plain
+// decimals are valid: strtod_l() also skips leading whitespace and reads hex,
+// inf and nan.
+bool agrees(const std::string& text) {
+    char* end;
+    const double expected = strtod_l(text.c_str(), &end, c_locale);
+    const bool valid = !text.empty() && end == text.c_str() + text.size() &&
+                       text.find_first_not_of("+-.0123456789eE") == std::string::npos;
+
+    double value = 12345;
+    const bool parsed = parse_decimal(text.data(), text.data() + text.size(), value);
+    if (parsed != valid) {
+        std::fprintf(stderr, "FAIL: \"%s\" %s\n", text.c_str(),
+                     valid ? "rejected" : "accepted");
+        return false;
+    }
+    if (!parsed) {
+        if (value != 12345) {
+            std::fprintf(stderr, "FAIL: \"%s\" rejected but value changed\n", text.c_str());
+            return false;
+        }
+        return true;
+    }
+    if (std::memcmp(&value, &expected, sizeof(double)) != 0) {
+        std::fprintf(stderr, "FAIL: \"%s\" gave %.17g, strtod_l %.17g\n",
+                     text.c_str(), value, expected);
+        return false;
+    }
+    return true;
+}
+
+const char* const BOUNDARIES[] = {
+    // Mantissas either side of 2^53.
+    "9007199254740992", "9007199254740993", "9007199254740991",
+    "-9007199254740993", "9007199254740993e-3", "900719925474099.3",
+    "9007199254740992e22", "9007199254740993e22",
+    // 19 and 20 significant digits, with and without dropped digits.
+    "1234567890123456789", "12345678901234567890", "12345678901234567891",
+    "9999999999999999999", "99999999999999999999", "18446744073709551615",
+    "18446744073709551616", "1.234567890123456789", "0.12345678901234567891",
+    "1234567890123456789000000", "10000000000000000000", "10000000000000000001",
+    // Exponents either side of the exact powers.
+    "1e22", "1e23", "1e-22", "1e-23", "3e22", "3e23", "3e-22", "3e-23",
+    "123.456e20", "123.456e21", "0.001e25", "0.001e26", "4.5e-22", "4.5e-23",
+    "1e308", "1e309", "1e-308", "4.9e-324", "2e-324", "1e-400", "1e400",
+    "1e+22", "1E23", "1e0", "1e-0", "1e0000000000000000000000001",
+    // Leading and trailing zeros.
+    "0", "00", "007", "000.5", "0.000", "0.0001", "00000000000000000000001",
+    "0.00000000000000000000000000001", "100", "1.000000000000000000000000",
+    "0000000000000000000012345678901234567890",
+    // Missing parts, signs and zeros.
+    "1.", ".5", "-.5", "+.5", "-1.", "0.", ".0", "-0", "+0", "-0.0", "-0e5",
+    "-0.000e-400", "+1", "-1",
+    // Not numbers.
+    "", "+", "-", ".", "-.", "+.", "e5", ".e5", "1e", "1e+", "1e-", "1.5.", "1..5",
+    "--1", "+-1", "1 ", " 1", "1x", "0x10", "inf", "nan", "1e5.5", "1,5",
+};
+
+// A random number: optional sign, up to 25 integer and fraction digits,
+// often with leading or trailing zeros, optional exponent.
+std::string random_number(std::mt19937& random) {
+    auto below = [&](int n) { return std::uniform_int_distribution<int>(0, n - 1)(random); };
+    const char* const signs[] = {"", "", "-", "+"};
+
+    std::string text = signs[below(4)];
+    const int zeros = below(4) == 0 ? below(6) : 0;
+    text.append(zeros, '0');
+    const int integer = below(4) == 0 ? below(26) : below(8);
+    for (int i = 0; i < integer; ++i) {
+        text += static_cast<char>('0' + below(10));
+    }
+    if (below(3) != 0) {
+        text += '.';
+        const int fraction = below(4) == 0 ? below(26) : below(8);
+        for (int i = 0; i < fraction; ++i) {
+            text += static_cast<char>('0' + below(10));
+        }
+        if (below(8) == 0) {
+            text.append(below(6), '0');
+        }
+    }
+    if (below(4) == 0) {
+        text += below(2) ? 'e' : 'E';
+        text += signs[below(4)];
+        const int exponent = below(2) ? below(30) : below(400);
+        text += std::to_string(exponent);
+    }
+    return text;
+}
+
+// A random double printed the ways plots and printf() do.
+std::string random_printed(std::mt19937& random) {
+    std::uint64_t bits = random();
+    bits = bits << 32 | random();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) {
+        value = 0;
+    }
+    char text[64];
+    switch (random() % 3) {
+    case 0:
+        std::snprintf(text, sizeof(text), "%.17g", value);
+        break;
+    case 1:
+        std::snprintf(text, sizeof(text), "%.*f", static_cast<int>(random() % 8),
+                      std::ldexp(static_cast<double>(random() % 2000000) - 1000000, -7));
+        break;
+    default:
+        std::snprintf(text, sizeof(text), "%.*g", static_cast<int>(random() % 20 + 1), value);
+        break;
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const long count = argc > 1 ? std::atol(argv[1]) : 2000000;
+    c_locale = newlocale(LC_ALL_MASK, "C", locale_t(0));
+
+    int failures = 0;
+    for (const char* text : BOUNDARIES) {
+        failures += !agrees(text);
+    }
+
+    std::mt19937 random(20240601);
+    for (long i = 0; i < count && failures < 20; ++i) {
+        failures += !agrees(i % 2 ? random_number(random) : random_printed(random));
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("parse_decimal() matches strtod_l() on %ld numbers\n",
+                count + static_cast<long>(sizeof(BOUNDARIES) / sizeof(BOUNDARIES[0])));
+    return 0;
+}
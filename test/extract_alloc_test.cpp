@@ -0,0 +1,96 @@
+// Checks that building a scene from a parsed plot allocates nothing once
+// the scene has room for it: element_kind(), parse_line() and parse_arc()
+// read the names and values in the document in place.
+//
+// Usage: extract_alloc_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot.h"
+#include "rapidxml.hpp"
+#include "scene.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::size_t allocations = 0;
+
+// Adds the primitives under root to scene, and returns how many there were.
+std::size_t extract(rapidxml::xml_node<>* root, Scene& scene) {
+    std::size_t elements = 0;
+    for (rapidxml::xml_node<>* node = root->first_node(); node; node = node->next_sibling()) {
+        const auto name = node->name_ref();
+        switch (element_kind(name.data(), name.size())) {
+        case Element::Line:
+            scene.add(parse_line(node));
+            break;
+        case Element::Arc:
+            scene.add(parse_arc(node));
+            break;
+        default:
+            std::fprintf(stderr, "Unknown element\n");
+            std::exit(1);
+        }
+        ++elements;
+    }
+    return elements;
+}
+
+} // namespace
+
+// The array forms forward to these.
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const PlotCounts counts = count_plot(file.data(), file.size());
+    rapidxml::xml_document<> doc;
+    doc.reserve(2 * counts.elements * sizeof(rapidxml::xml_node<>));
+    doc.parse<rapidxml::parse_non_destructive>(file.data());
+    if (!doc.first_node()) {
+        std::fprintf(stderr, "No root element in: %s\n", argv[1]);
+        return 2;
+    }
+
+    // The first pass pays for anything set up on first use.
+    Scene warm;
+    warm.reserve(counts.lines, counts.arcs);
+    extract(doc.first_node(), warm);
+
+    Scene scene;
+    scene.reserve(counts.lines, counts.arcs);
+    const std::size_t before = allocations;
+    const std::size_t elements = extract(doc.first_node(), scene);
+    const std::size_t allocated = allocations - before;
+
+    std::printf("%zu elements, %zu allocations\n", elements, allocated);
+    if (elements == 0 || scene.line_count() + scene.arc_count() != elements) {
+        std::fprintf(stderr, "FAIL: expected %zu primitives\n", elements);
+        return 1;
+    }
+    if (allocated != 0) {
+        std::fprintf(stderr, "FAIL: extraction allocated\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+// Checks that draw_lines() sets exactly the pixels cv::line() does at
+// thickness 1, LINE_8: the lines of a plot fitted to canvases of several
+// sizes, and seeded random segments that cross the image edges, are
+// degenerate, axis-aligned or steep.  Each set is drawn over the whole image,
+// through tile windows of it, and into tiles with storage of their own, on
+// one- and three-channel images from 1x1 up.
+//
+// Usage: line_raster_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "raster.h"
+#include "scene.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Segments {
+    std::vector<int> x_start;
+    std::vector<int> y_start;
+    std::vector<int> x_end;
+    std::vector<int> y_end;
+    std::vector<Pixel> pixels;
+
+    void add(int xs, int ys, int xe, int ye) {
+        // Segments overlap, so each gets a value of its own to check the
+        // drawing order too.
+        const unsigned char value = static_cast<unsigned char>(pixels.size() % 251 + 1);
+        const Pixel pixel = {{value, static_cast<unsigned char>(value ^ 0x55),
+                              static_cast<unsigned char>(value ^ 0xaa)}};
+        x_start.push_back(xs);
+        y_start.push_back(ys);
+        x_end.push_back(xe);
+        y_end.push_back(ye);
+        pixels.push_back(pixel);
+    }
+
+    std::size_t size() const { return pixels.size(); }
+};
+
+// The lines of scene on canvas, with the end points render.cpp gives them.
+Segments plot_segments(const Scene& plot, const Canvas& canvas) {
+    Scene scene = plot;
+    scene.to_image(canvas);
+    Segments segments;
+    for (std::size_t i = 0; i < scene.line_count(); ++i) {
+        const Line line = scene.line(i);
+        const cv::Point start = cv::Point2f(line.x_start, line.y_start);
+        const cv::Point end = cv::Point2f(line.x_end, line.y_end);
+        segments.add(start.x, start.y, end.x, end.y);
+    }
+    return segments;
+}
+
+Segments random_segments(std::mt19937& random, int width, int height) {
+    const int reach = 3 * (width + height);
+    auto inside_x = [&]() { return std::uniform_int_distribution<int>(0, width - 1)(random); };
+    auto inside_y = [&]() { return std::uniform_int_distribution<int>(0, height - 1)(random); };
+    auto any_x = [&]() { return std::uniform_int_distribution<int>(-reach, width + reach)(random); };
+    auto any_y = [&]() { return std::uniform_int_distribution<int>(-reach, height + reach)(random); };
+    auto far = [&]() { return std::uniform_int_distribution<int>(-(1 << 20), 1 << 20)(random); };
+    auto small = [&]() { return std::uniform_int_distribution<int>(-3, 3)(random); };
+
+    Segments segments;
+    for (int i = 0; i < 100; ++i) {
+        // Crossing one or more edges.
+        segments.add(inside_x(), inside_y(), any_x(), any_y());
+        segments.add(any_x(), any_y(), any_x(), any_y());
+        segments.add(far(), far(), far(), far());
+        // Degenerate and nearly so.
+        const int x = any_x();
+        const int y = any_y();
+        segments.add(x, y, x, y);
+        segments.add(x, y, x + small(), y + small());
+        // Vertical and horizontal, along and just off the edges too.
+        const int column = i % 4 == 0 ? 0 : i % 4 == 1 ? width - 1 : i % 4 == 2 ? -1 : inside_x();
+        const int row = i % 4 == 0 ? 0 : i % 4 == 1 ? height - 1 : i % 4 == 2 ? height : inside_y();
+        segments.add(column, any_y(), column, any_y());
+        segments.add(any_x(), row, any_x(), row);
+        // Steep and shallow.
+        const int run = small();
+        segments.add(x, any_y(), x + run, any_y());
+        segments.add(any_x(), y, any_x(), y + run);
+    }
+    return segments;
+}
+
+cv::Mat reference(const Segments& segments, int width, int height, int channels) {
+    cv::Mat image(height, width, CV_8UC(channels), cv::Scalar::all(0));
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        const unsigned char* value = segments.pixels[i].value;
+        cv::line(image, cv::Point(segments.x_start[i], segments.y_start[i]),
+                 cv::Point(segments.x_end[i], segments.y_end[i]),
+                 cv::Scalar(value[0], value[1], value[2]), 1, cv::LINE_8);
+    }
+    return image;
+}
+
+void draw(const Raster& raster, const Segments& segments) {
+    draw_lines(raster, segments.x_start.data(), segments.y_start.data(),
+               segments.x_end.data(), segments.y_end.data(),
+               segments.pixels.data(), segments.size());
+}
+
+bool same(const cv::Mat& a, const cv::Mat& b) {
+    const std::size_t row = a.cols * a.elemSize();
+    for (int y = 0; y < a.rows; ++y) {
+        if (std::memcmp(a.ptr(y), b.ptr(y), row) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Draws segments every way onto a width x height image and counts the ways
+// that differ from cv::line().
+int check(const char* what, const Segments& segments, int width, int height) {
+    int failures = 0;
+    for (int channels = 1; channels <= 3; channels += 2) {
+        const cv::Mat expected = reference(segments, width, height, channels);
+
+        cv::Mat whole(height, width, CV_8UC(channels), cv::Scalar::all(0));
+        draw(Raster(whole.data, whole.step, channels, width, height), segments);
+        if (!same(whole, expected)) {
+            std::fprintf(stderr, "FAIL: %s, %dx%dx%d, whole image\n", what, width, height, channels);
+            ++failures;
+        }
+
+        const int tiles[] = {1, 7, 64, 256};
+        for (const int tile : tiles) {
+            // Every segment is set up for every tile, so small tiles are
+            // only tried on small images.
+            const long count = static_cast<long>((width + tile - 1) / tile) *
+                               ((height + tile - 1) / tile);
+            if ((tile > 1 && tile >= std::max(width, height)) || count > 1 << 14) {
+                continue;
+            }
+
+            cv::Mat windows(height, width, CV_8UC(channels), cv::Scalar::all(0));
+            cv::Mat copies(height, width, CV_8UC(channels), cv::Scalar::all(0));
+            const Raster image(windows.data, windows.step, channels, width, height);
+            std::vector<unsigned char> storage(static_cast<std::size_t>(tile) * tile * channels);
+            for (int y0 = 0; y0 < height; y0 += tile) {
+                for (int x0 = 0; x0 < width; x0 += tile) {
+                    const int x1 = std::min(x0 + tile, width) - 1;
+                    const int y1 = std::min(y0 + tile, height) - 1;
+                    draw(image.window(x0, y0, x1, y1), segments);
+
+                    const std::size_t step = static_cast<std::size_t>(tile) * channels;
+                    std::fill(storage.begin(), storage.end(), 0);
+                    draw(Raster(storage.data(), step, channels, width, height, x0, y0, x1, y1),
+                         segments);
+                    for (int y = y0; y <= y1; ++y) {
+                        std::memcpy(copies.ptr(y) + x0 * channels, &storage[(y - y0) * step],
+                                    (x1 - x0 + 1) * channels);
+                    }
+                }
+            }
+            if (!same(windows, expected)) {
+                std::fprintf(stderr, "FAIL: %s, %dx%dx%d, %d pixel windows\n",
+                             what, width, height, channels, tile);
+                ++failures;
+            }
+            if (!same(copies, expected)) {
+                std::fprintf(stderr, "FAIL: %s, %dx%dx%d, %d pixel tiles\n",
+                             what, width, height, channels, tile);
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    if (plot.line_count() == 0) {
+        std::fprintf(stderr, "No lines in: %s\n", argv[1]);
+        return 2;
+    }
+
+    const int sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {2, 3}, {17, 5}, {100, 100},
+                            {333, 217}, {1000, 1000}, {4000, 3000}};
+    std::mt19937 random(20240601);
+    int failures = 0;
+    for (const auto& size : sizes) {
+        const int width = size[0];
+        const int height = size[1];
+        // The plot fitted to the canvas, and at its own scale with the origin
+        // in the middle, which for small canvases leaves most of it outside.
+        failures += check("plot fitted", plot_segments(plot, Canvas::fit(plot.bounds(), width, height)),
+                          width, height);
+        failures += check("plot", plot_segments(plot, Canvas(width, height, -width / 2, -height / 2)),
+                          width, height);
+        failures += check("random", random_segments(random, width, height), width, height);
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("draw_lines() matches cv::line()\n");
+    return 0;
+}
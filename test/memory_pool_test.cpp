@@ -0,0 +1,167 @@
+// Checks that a rapidxml document reuses its memory: once the pool has grown
+// to fit a document, parsing it again after reset() allocates nothing, nor
+// does parsing after reserve() for the document's size.  Blocks given up by
+// reset() are handed out again only if they are large enough, and clear()
+// and the destructor free everything.  The plot is repeated a few times so
+// that it needs several dynamic blocks.
+//
+// Usage: memory_pool_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot.h"
+#include "rapidxml.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::size_t allocations = 0;
+std::size_t frees = 0;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// Elements and bytes of values in the document, to check each parse read
+// the whole of it.
+std::size_t signature(const rapidxml::xml_node<>* node) {
+    std::size_t sum = node->value_size() + 1;
+    for (const rapidxml::xml_node<>* child = node->first_node(); child;
+         child = child->next_sibling()) {
+        sum += signature(child);
+    }
+    return sum;
+}
+
+// Parses a fresh copy of text in place into doc, returning the allocations
+// made.
+std::size_t parse(rapidxml::xml_document<>& doc, const std::string& text,
+                  std::vector<char>& buffer, std::size_t& sum) {
+    std::memcpy(buffer.data(), text.c_str(), text.size() + 1);
+    const std::size_t before = allocations;
+    doc.parse<0>(buffer.data());
+    const std::size_t allocated = allocations - before;
+    sum = signature(&doc);
+    return allocated;
+}
+
+} // namespace
+
+// The array forms forward to these.
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    frees += p != nullptr;
+    std::free(p);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+
+    std::string small;
+    {
+        MappedFile file;
+        if (!file.open(argv[1], false)) {
+            std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+            return 2;
+        }
+        small.assign(file.data(), file.size());
+    }
+    const std::size_t first = small.find("<Line");
+    const std::size_t last = small.rfind("</ppcPlot>");
+    if (first == std::string::npos || last == std::string::npos || last <= first) {
+        std::fprintf(stderr, "No <ppcPlot> elements in: %s\n", argv[1]);
+        return 2;
+    }
+    std::string large = "<ppcPlot>";
+    for (int i = 0; i < 8; ++i) {
+        large.append(small, first, last - first);
+    }
+    large += "</ppcPlot>";
+    std::vector<char> buffer(large.size() + 1);
+
+    const std::size_t start = allocations;
+    const std::size_t start_frees = frees;
+    std::size_t large_sum;
+    {
+        // Small blocks, so the large document takes many of them.
+        rapidxml::xml_document<> doc;
+        doc.set_block_size(4096);
+        std::size_t& sum = large_sum;
+        const std::size_t grown = parse(doc, large, buffer, sum);
+        check(grown > 1, "the first parse allocates dynamic blocks");
+        for (int round = 0; round < 5; ++round) {
+            doc.reset();
+            std::size_t again;
+            check(parse(doc, large, buffer, again) == 0, "parsing again after reset() allocates");
+            check(again == sum, "parsing again after reset() gives the same document");
+        }
+
+        // A smaller document fits in what the large one left.
+        doc.reset();
+        std::size_t small_sum;
+        check(parse(doc, small, buffer, small_sum) == 0,
+              "a smaller document after reset() allocates");
+
+        // A string larger than the static memory and any block needs a block
+        // of its own, which is then reused.
+        const std::size_t huge = RAPIDXML_STATIC_POOL_SIZE + 2 * 4096;
+        doc.reset();
+        std::size_t before = allocations;
+        doc.allocate_string(0, huge);
+        check(allocations - before == 1, "a string larger than the blocks allocates once");
+        doc.reset();
+        before = allocations;
+        doc.allocate_string(0, huge);
+        check(allocations == before, "a large string after reset() allocates");
+
+        // clear() gives everything back.
+        doc.clear();
+        check(allocations - start == frees - start_frees, "clear() frees every block");
+        std::size_t again;
+        check(parse(doc, large, buffer, again) == grown, "clear() keeps blocks");
+    }
+    check(allocations - start == frees - start_frees, "the destructor frees every block");
+
+    {
+        // Reserved as main.cpp does, then parsed non-destructively.
+        const PlotCounts counts = count_plot(large.data(), large.size());
+        rapidxml::xml_document<> doc;
+        std::size_t before = allocations;
+        doc.reserve(2 * counts.elements * sizeof(rapidxml::xml_node<>));
+        check(allocations - before == 1, "reserve() allocates one block");
+        before = allocations;
+        doc.parse<rapidxml::parse_non_destructive>(&large[0]);
+        check(allocations == before, "parsing after reserve() allocates");
+        check(signature(&doc) == large_sum, "parsing after reserve() gives the same document");
+        doc.reset();
+        before = allocations;
+        doc.reserve(2 * counts.elements * sizeof(rapidxml::xml_node<>));
+        check(allocations == before, "reserve() after reset() allocates");
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("memory_pool reuses its blocks\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+// Checks PlotArchive in a temporary directory: a plot and seeded random
+// scenes of many blocks, in doubles and in fixed point, read back equal to
+// what was written, on 1, 3 and all hardware threads alike, and appended
+// after what the scene already holds.  Every truncation of an archive and a
+// block count too large for the file are rejected, leaving the scene
+// unchanged; flipped bytes anywhere are either rejected likewise or (for
+// flipped values) read as an archive of the same shape.
+//
+// Usage: plot_archive_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_archive.h"
+#include "plot_schema.h"
+#include "scene.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+bool same(const Scene& a, const Scene& b) {
+    if (a.line_count() != b.line_count() || a.arc_count() != b.arc_count()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.line_count(); ++i) {
+        const Line x = a.line(i);
+        const Line y = b.line(i);
+        if (x.x_start != y.x_start || x.x_end != y.x_end || x.y_start != y.y_start ||
+            x.y_end != y.y_end || x.color != y.color) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < a.arc_count(); ++i) {
+        const Arc x = a.arc(i);
+        const Arc y = b.arc(i);
+        if (x.x_center != y.x_center || x.y_center != y.y_center || x.radius != y.radius ||
+            x.arc_start != y.arc_start || x.arc_extend != y.arc_extend || x.color != y.color) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_file(const std::string& name, const std::string& data) {
+    std::FILE* out = std::fopen(name.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    const bool written = std::fwrite(data.data(), 1, data.size(), out) == data.size();
+    return std::fclose(out) == 0 && written;
+}
+
+std::string read_file(const std::string& name) {
+    MappedFile file;
+    if (!file.open(name, false)) {
+        return std::string();
+    }
+    return std::string(file.data(), file.size());
+}
+
+void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// A scene holding one line already, to see that read() appends, and that a
+// failed read() leaves it alone.
+Scene prefixed(int scale) {
+    Scene scene = scale ? Scene(scale) : Scene();
+    scene.add(Line(1, 2, 3, 4, Color::Red));
+    return scene;
+}
+
+// Writes scene to archive and reads it back on several thread counts.
+void check_round_trip(const std::string& archive, const Scene& scene, const std::string& detail) {
+    PlotArchive writer;
+    check(writer.write(archive, scene), "write() fails", detail + ": " + writer.error());
+    check(PlotArchive::is_archive(archive), "is_archive() misses an archive", detail);
+
+    Scene expected = prefixed(scene.scale());
+    expected.append(scene);
+    const unsigned thread_counts[] = {1, 3, 0};
+    for (const unsigned threads : thread_counts) {
+        const std::string where = detail + ", " + std::to_string(threads) + " threads";
+        PlotArchive reader;
+        Scene read = prefixed(scene.scale());
+        check(reader.read(archive, threads, read), "read() fails", where + ": " + reader.error());
+        check(same(read, expected), "read() gives another scene than was written", where);
+        check(read.fixed() == scene.fixed(), "read() changes the storage", where);
+    }
+}
+
+// An archive that read() must turn down, without touching the scene.
+void check_rejected(const std::string& archive, const std::string& data, const char* what,
+                    const std::string& detail) {
+    check(write_file(archive, data), "unable to write", archive);
+    PlotArchive reader;
+    Scene scene = prefixed(0);
+    check(!reader.read(archive, 3, scene), what, detail);
+    check(same(scene, prefixed(0)), "a failed read() changes the scene", detail);
+}
+
+// Values in hundredths, within what scale 100 holds in fixed point, over
+// several blocks of each kind.
+Scene random_scene(std::mt19937& random, int scale) {
+    auto hundredths = [&](int range) {
+        return std::uniform_int_distribution<int>(-range, range)(random) / 100.0;
+    };
+    auto color = [&]() { return static_cast<Color>(random() % 5); };
+    Scene scene = scale ? Scene(scale) : Scene();
+    for (std::size_t i = 0; i < 3 * PlotArchive::BLOCK_SIZE + 17; ++i) {
+        scene.add(Line(hundredths(30000), hundredths(30000), hundredths(30000),
+                       hundredths(30000), color()));
+        if (i % 2 == 0) {
+            scene.add(Arc(hundredths(30000), hundredths(30000), hundredths(30000),
+                          hundredths(30000), hundredths(30000), color()));
+        }
+    }
+    return scene;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    std::string root = std::string(tmp && *tmp ? tmp : "/tmp") + "/plot_archive_test.XXXXXX";
+    if (!::mkdtemp(&root[0])) {
+        std::fprintf(stderr, "Unable to make a directory from: %s\n", root.c_str());
+        return 2;
+    }
+    const std::string archive = root + "/plot.ppcpack";
+    check(!PlotArchive::is_archive(argv[1]), "is_archive() takes a plot for an archive", argv[1]);
+
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    Scene fixed_plot(10);
+    parse_plot_schema(file.data(), file.size(), fixed_plot);
+    check(fixed_plot.fixed(), "the plot is not fixed point at scale 10", "plot");
+    check_round_trip(archive, plot, "plot");
+    check_round_trip(archive, fixed_plot, "plot, scale 10");
+
+    std::mt19937 random(20240601);
+    check_round_trip(archive, random_scene(random, 0), "random");
+    const Scene fixed = random_scene(random, 100);
+    check(fixed.fixed(), "the random scene is not fixed point at scale 100", "random");
+    check_round_trip(archive, fixed, "random, scale 100");
+
+    Scene inexact;
+    inexact.add(Line(0.1234567, 0, 0, 0, Color::Blue));
+    PlotArchive writer;
+    check(!writer.write(archive, inexact), "write() takes a value of 7 decimals", "inexact");
+
+    // Every truncation of a small archive, and a sample of a large one.
+    check(writer.write(archive, plot), "write() fails", "plot");
+    const std::string small = read_file(archive);
+    for (std::size_t cut = 0; cut < small.size(); ++cut) {
+        check_rejected(archive, small.substr(0, cut), "read() takes a truncated archive",
+                       "plot, " + std::to_string(cut) + " bytes");
+    }
+    check(writer.write(archive, random_scene(random, 0)), "write() fails", "random");
+    const std::string large = read_file(archive);
+    for (int i = 0; i < 200; ++i) {
+        const std::size_t cut = i < 100 ? i : random() % large.size();
+        check_rejected(archive, large.substr(0, cut), "read() takes a truncated archive",
+                       "random, " + std::to_string(cut) + " bytes");
+    }
+
+    // A block count that fits the file size but not its directory: refused
+    // from the header, before anything is sized by it.
+    std::string header("PPCPACK", 8);
+    put_varint(header, 1);
+    put_varint(header, 1);
+    put_varint(header, 0);
+    put_varint(header, 0);
+    std::string huge = header;
+    put_varint(huge, 1000);
+    huge.append(2999, '\0');
+    check_rejected(archive, huge, "read() takes a block count too large for the file", "count");
+    PlotArchive reader;
+    Scene scene;
+    reader.read(archive, 1, scene);
+    check(reader.error().find("header") != std::string::npos,
+          "a block count too large for the file is not a header error", reader.error());
+    std::string empty = header;
+    put_varint(empty, 0);
+    check(write_file(archive, empty) && reader.read(archive, 1, scene) &&
+          scene.line_count() == 0 && scene.arc_count() == 0,
+          "read() fails on an empty archive", reader.error());
+
+    // Flipped bytes must not crash read(); what it takes must have the
+    // shape of the original, since the counts are checked against the
+    // directory and every block against its payload size.
+    check(writer.write(archive, plot), "write() fails", "plot");
+    for (std::size_t i = 0; i < small.size(); ++i) {
+        std::string flipped = small;
+        flipped[i] = static_cast<char>(flipped[i] ^ (1 + random() % 255));
+        check(write_file(archive, flipped), "unable to write", archive);
+        Scene read = prefixed(0);
+        const std::string detail = "byte " + std::to_string(i);
+        if (reader.read(archive, 3, read)) {
+            check(read.line_count() == plot.line_count() + 1 &&
+                      read.arc_count() == plot.arc_count(),
+                  "read() takes a corrupt archive of another shape", detail);
+        } else {
+            check(same(read, prefixed(0)), "a failed read() changes the scene", detail);
+        }
+    }
+
+    std::remove(archive.c_str());
+    ::rmdir(root.c_str());
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("Plot archives round-trip and corrupt ones are rejected\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Checks that a fixed-point scene at one unit per pixel, which the renderers
+// read straight from its integer columns, gives the same image as the same
+// primitives held in doubles: through drawlines() and drawarcs(), and
+// through TileRenderer.  The primitives are those of a plot rounded to whole
+// units, and seeded random ones that cross the image edges, have negative
+// radii and reversed or long spans.
+//
+// Usage: render_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "render.h"
+#include "scene.h"
+#include <opencv2/opencv.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+bool same_pixels(const cv::Mat& a, const cv::Mat& b) {
+    if (a.rows != b.rows || a.cols != b.cols) {
+        return false;
+    }
+    for (int y = 0; y < a.rows; ++y) {
+        if (std::memcmp(a.ptr(y), b.ptr(y), a.cols * a.elemSize()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+cv::Mat render_serial(const Scene& scene, const Canvas& canvas) {
+    cv::Mat image(canvas.height, canvas.width, CV_8UC3, cv::Scalar(0));
+    StampCache stamps;
+    drawlines(image, scene);
+    drawarcs(image, scene, stamps);
+    return image;
+}
+
+cv::Mat render_tiled(const Scene& scene, const Canvas& canvas) {
+    cv::Mat image(canvas.height, canvas.width, CV_8UC3, cv::Scalar(0));
+    TileRenderer renderer(3, 64);
+    renderer.render(scene, image);
+    return image;
+}
+
+// Puts the primitives of fixed and doubles on canvas and compares their
+// images; fixed must still be fixed point at one unit per pixel afterwards.
+void check_scenes(Scene fixed, Scene doubles, const Canvas& canvas, const std::string& detail) {
+    fixed.to_image(canvas);
+    doubles.to_image(canvas);
+    check(fixed.fixed() && fixed.scale() == 1 && !doubles.fixed(),
+          "scenes not stored as expected", detail);
+    const cv::Mat expected = render_serial(doubles, canvas);
+    check(same_pixels(render_serial(fixed, canvas), expected),
+          "drawlines() and drawarcs() differ on the fixed-point scene", detail);
+    check(same_pixels(render_tiled(fixed, canvas), render_tiled(doubles, canvas)),
+          "TileRenderer differs on the fixed-point scene", detail);
+}
+
+double whole(double value) {
+    return std::round(value);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    Scene fixed_plot(1);
+    Scene double_plot;
+    for (std::size_t i = 0; i < plot.line_count(); ++i) {
+        const Line line = plot.line(i);
+        const Line rounded(whole(line.x_start), whole(line.x_end), whole(line.y_start),
+                           whole(line.y_end), line.color);
+        fixed_plot.add(rounded);
+        double_plot.add(rounded);
+    }
+    for (std::size_t i = 0; i < plot.arc_count(); ++i) {
+        const Arc arc = plot.arc(i);
+        const Arc rounded(whole(arc.x_center), whole(arc.y_center), whole(arc.radius),
+                          whole(arc.arc_start), whole(arc.arc_extend), arc.color);
+        fixed_plot.add(rounded);
+        double_plot.add(rounded);
+    }
+    check_scenes(fixed_plot, double_plot, Canvas(640, 640), "plot");
+    check_scenes(fixed_plot, double_plot, Canvas(300, 200, 100, 150), "plot, cropped");
+
+    std::mt19937 random(20240601);
+    for (int round = 0; round < 10; ++round) {
+        const int width = 1 + random() % 400;
+        const int height = 1 + random() % 400;
+        auto coordinate = [&](int side) {
+            return std::uniform_int_distribution<int>(-side / 2 - 20, side + side / 2 + 20)(random);
+        };
+        auto color = [&]() { return static_cast<Color>(random() % 5); };
+        Scene fixed(1);
+        Scene doubles;
+        for (int i = 0; i < 500; ++i) {
+            const Line line(coordinate(width), coordinate(width), coordinate(height),
+                            coordinate(height), color());
+            fixed.add(line);
+            doubles.add(line);
+            const Arc arc(coordinate(width), coordinate(height),
+                          std::uniform_int_distribution<int>(-60, 300)(random),
+                          std::uniform_int_distribution<int>(-720, 720)(random),
+                          std::uniform_int_distribution<int>(-800, 800)(random), color());
+            fixed.add(arc);
+            doubles.add(arc);
+        }
+        check_scenes(fixed, doubles, Canvas(width, height),
+                     "random " + std::to_string(round) + ", " + std::to_string(width) + "x" +
+                         std::to_string(height));
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("Fixed-point scenes render like their doubles\n");
+    return 0;
+}
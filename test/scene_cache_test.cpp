@@ -0,0 +1,224 @@
+// Checks SceneCache in a temporary cache directory, on a copy of a plot:
+// scenes of doubles, of scale 10 and of scale 10 fallen back to doubles
+// load back equal to what was stored; an entry is not used for another scale,
+// nor once its source has been touched or rewritten, which makes the caller
+// parse again; truncated and corrupted entries are rejected and leave the
+// scene untouched.
+//
+// Usage: scene_cache_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "scene.h"
+#include "scene_cache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+bool same(const Scene& a, const Scene& b) {
+    if (a.fixed() != b.fixed() || a.line_count() != b.line_count() ||
+        a.arc_count() != b.arc_count()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.line_count(); ++i) {
+        const Line x = a.line(i);
+        const Line y = b.line(i);
+        if (x.x_start != y.x_start || x.x_end != y.x_end || x.y_start != y.y_start ||
+            x.y_end != y.y_end || x.color != y.color) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < a.arc_count(); ++i) {
+        const Arc x = a.arc(i);
+        const Arc y = b.arc(i);
+        if (x.x_center != y.x_center || x.y_center != y.y_center || x.radius != y.radius ||
+            x.arc_start != y.arc_start || x.arc_extend != y.arc_extend || x.color != y.color) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_file(const std::string& name, const std::string& data) {
+    std::FILE* out = std::fopen(name.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    const bool written = std::fwrite(data.data(), 1, data.size(), out) == data.size();
+    return std::fclose(out) == 0 && written;
+}
+
+std::string read_file(const std::string& name) {
+    MappedFile file;
+    if (!file.open(name, false)) {
+        return std::string();
+    }
+    return std::string(file.data(), file.size());
+}
+
+// The one entry in directory.
+std::string entry_in(const std::string& directory) {
+    std::string entry;
+    if (DIR* dir = ::opendir(directory.c_str())) {
+        while (const dirent* e = ::readdir(dir)) {
+            const std::string name = e->d_name;
+            if (name.size() > 6 && name.compare(name.size() - 6, 6, ".scene") == 0) {
+                entry = directory + "/" + name;
+            }
+        }
+        ::closedir(dir);
+    }
+    return entry;
+}
+
+// Sets the modification time of name to sec seconds after the epoch.
+bool touch(const std::string& name, long sec) {
+    struct timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = sec;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    return ::utimensat(AT_FDCWD, name.c_str(), times, 0) == 0;
+}
+
+// A scene that was not loaded: one line, to see that a failed load leaves
+// it alone.
+Scene untouched(int scale) {
+    Scene scene = scale ? Scene(scale) : Scene();
+    scene.add(Line(1, 2, 3, 4, Color::Red));
+    return scene;
+}
+
+// Stores scene for source, loads it back into a scene of the same scale and
+// checks the two match.
+void check_round_trip(const SceneCache& cache, const std::string& source, const Scene& scene,
+                      const std::string& detail) {
+    check(cache.store(source, scene), "store() fails", detail);
+    Scene loaded = untouched(scene.scale());
+    check(cache.load(source, loaded), "load() misses a fresh entry", detail);
+    check(same(loaded, scene), "load() gives another scene than was stored", detail);
+}
+
+// A load of source that must miss.
+void check_miss(const SceneCache& cache, const std::string& source, int scale,
+                const char* what, const std::string& detail) {
+    Scene scene = untouched(scale);
+    check(!cache.load(source, scene), what, detail);
+    check(same(scene, untouched(scale)), "a missed load() changes the scene", detail);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    const std::string plot = read_file(argv[1]);
+    if (plot.empty()) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const char* tmp = std::getenv("TMPDIR");
+    std::string root = std::string(tmp && *tmp ? tmp : "/tmp") + "/scene_cache_test.XXXXXX";
+    if (!::mkdtemp(&root[0])) {
+        std::fprintf(stderr, "Unable to make a directory from: %s\n", root.c_str());
+        return 2;
+    }
+    const std::string source = root + "/plot.xml";
+    const std::string directory = root + "/cache/level4";
+    const SceneCache cache(directory);
+    if (!write_file(source, plot) || !touch(source, 1000000000)) {
+        std::fprintf(stderr, "Unable to write: %s\n", source.c_str());
+        return 2;
+    }
+
+    check_miss(cache, source, 0, "load() hits an empty cache", "empty");
+
+    Scene doubles;
+    parse_plot_schema(plot.data(), plot.size(), doubles);
+    check_round_trip(cache, source, doubles, "doubles");
+    check(!entry_in(directory).empty(), "store() makes no entry", "doubles");
+
+    Scene fixed(10);
+    parse_plot_schema(plot.data(), plot.size(), fixed);
+    check(fixed.fixed(), "the plot is not fixed point at scale 10", "scale 10");
+    check_round_trip(cache, source, fixed, "scale 10");
+    check_miss(cache, source, 0, "load() uses an entry of another scale", "scale 10 as doubles");
+    check_miss(cache, source, 100, "load() uses an entry of another scale", "scale 10 as 100");
+
+    Scene fallback = fixed;
+    fallback.add(Line(0.05, 1, 2, 3, Color::Blue));
+    check(!fallback.fixed() && fallback.scale() == 10, "the scene does not fall back",
+          "fallback");
+    check_round_trip(cache, source, fallback, "fallback");
+
+    // A touched source is parsed again, and the new entry used.
+    check_round_trip(cache, source, doubles, "before touching");
+    check(touch(source, 1000000001), "unable to touch the source", source);
+    check_miss(cache, source, 0, "load() uses the entry of a touched source", "touched");
+    Scene reparsed;
+    parse_plot_schema(plot.data(), plot.size(), reparsed);
+    check_round_trip(cache, source, reparsed, "after touching");
+
+    // Same modification time, other size.
+    check(write_file(source, plot + "<!-- rewritten -->\n") && touch(source, 1000000001),
+          "unable to rewrite the source", source);
+    check_miss(cache, source, 0, "load() uses the entry of a rewritten source", "rewritten");
+    check_round_trip(cache, source, reparsed, "after rewriting");
+
+    // Truncated and corrupted entries.
+    const std::string entry = entry_in(directory);
+    const std::string stored = read_file(entry);
+    check(!stored.empty(), "no entry to corrupt", entry);
+    const std::size_t cuts[] = {0, 7, 100, stored.size() / 2, stored.size() - 8,
+                                stored.size() - 1};
+    for (const std::size_t cut : cuts) {
+        if (cut < stored.size()) {
+            check(write_file(entry, stored.substr(0, cut)), "unable to truncate", entry);
+            check_miss(cache, source, 0, "load() accepts a truncated entry",
+                       std::to_string(cut) + " bytes");
+        }
+    }
+    check(write_file(entry, stored + std::string(8, '\0')), "unable to extend", entry);
+    check_miss(cache, source, 0, "load() accepts an entry with trailing bytes", "extended");
+    std::string magic = stored;
+    magic[0] = 'X';
+    check(write_file(entry, magic), "unable to corrupt", entry);
+    check_miss(cache, source, 0, "load() accepts a bad magic", "magic");
+    // The arc colors are the last block, padded to 8 bytes.
+    std::string color = stored;
+    color[stored.size() - ((reparsed.arc_count() + 7) & ~std::size_t(7))] = 100;
+    check(write_file(entry, color), "unable to corrupt", entry);
+    check_miss(cache, source, 0, "load() accepts a bad color", "color");
+    check(write_file(entry, stored), "unable to restore", entry);
+    Scene restored;
+    check(cache.load(source, restored) && same(restored, reparsed),
+          "load() misses a restored entry", "restored");
+
+    ::unlink(entry.c_str());
+    ::unlink(source.c_str());
+    ::rmdir(directory.c_str());
+    ::rmdir((root + "/cache").c_str());
+    ::rmdir(root.c_str());
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("Scene cache entries round-trip and stale ones are rejected\n");
+    return 0;
+}
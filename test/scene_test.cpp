@@ -0,0 +1,239 @@
+// Checks the bulk passes of Scene against per-primitive references, on
+// double and fixed-point scenes of plotMe.xml and of seeded random
+// primitives: cull() keeps exactly the primitives whose box meets the view,
+// in order; sort_by_color() is a stable sort by color; memory() counts the
+// bytes of the columns.  Canvas::fit() gives valid canvases of the requested
+// size that hold the plot, and for sides of 1 pixel keeps the requested
+// scale with the plot centered, so every primitive stays finite.
+//
+// Usage: scene_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+bool same(const Line& a, const Line& b) {
+    return a.x_start == b.x_start && a.x_end == b.x_end && a.y_start == b.y_start &&
+           a.y_end == b.y_end && a.color == b.color;
+}
+
+bool same(const Arc& a, const Arc& b) {
+    return a.x_center == b.x_center && a.y_center == b.y_center && a.radius == b.radius &&
+           a.arc_start == b.arc_start && a.arc_extend == b.arc_extend && a.color == b.color;
+}
+
+std::vector<Line> lines_of(const Scene& scene) {
+    std::vector<Line> lines;
+    for (std::size_t i = 0; i < scene.line_count(); ++i) {
+        lines.push_back(scene.line(i));
+    }
+    return lines;
+}
+
+std::vector<Arc> arcs_of(const Scene& scene) {
+    std::vector<Arc> arcs;
+    for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+        arcs.push_back(scene.arc(i));
+    }
+    return arcs;
+}
+
+void check_contents(const Scene& scene, const std::vector<Line>& lines,
+                    const std::vector<Arc>& arcs, const char* what, const std::string& detail) {
+    const std::vector<Line> got_lines = lines_of(scene);
+    const std::vector<Arc> got_arcs = arcs_of(scene);
+    check(got_lines.size() == lines.size() &&
+          std::equal(lines.begin(), lines.end(), got_lines.begin(),
+                     [](const Line& a, const Line& b) { return same(a, b); }),
+          what, detail + ", lines");
+    check(got_arcs.size() == arcs.size() &&
+          std::equal(arcs.begin(), arcs.end(), got_arcs.begin(),
+                     [](const Arc& a, const Arc& b) { return same(a, b); }),
+          what, detail + ", arcs");
+}
+
+bool meets(const Line& line, const Bounds& view) {
+    return std::max(line.x_start, line.x_end) >= view.x_min &&
+           std::min(line.x_start, line.x_end) <= view.x_max &&
+           std::max(line.y_start, line.y_end) >= view.y_min &&
+           std::min(line.y_start, line.y_end) <= view.y_max;
+}
+
+bool meets(const Arc& arc, const Bounds& view) {
+    const double r = std::fabs(arc.radius);
+    return arc.x_center + r >= view.x_min && arc.x_center - r <= view.x_max &&
+           arc.y_center + r >= view.y_min && arc.y_center - r <= view.y_max;
+}
+
+void check_scene(const Scene& scene, std::mt19937& random, const std::string& detail) {
+    const std::vector<Line> lines = lines_of(scene);
+    const std::vector<Arc> arcs = arcs_of(scene);
+
+    const std::size_t value = scene.fixed() ? sizeof(std::int16_t) : sizeof(double);
+    check(scene.memory() == lines.size() * (4 * value + 1) + arcs.size() * (5 * value + 1),
+          "memory() miscounts", detail);
+
+    Scene sorted = scene;
+    sorted.sort_by_color();
+    std::vector<Line> sorted_lines = lines;
+    std::vector<Arc> sorted_arcs = arcs;
+    auto by_color = [](const Line& a, const Line& b) { return a.color < b.color; };
+    auto arc_by_color = [](const Arc& a, const Arc& b) { return a.color < b.color; };
+    std::stable_sort(sorted_lines.begin(), sorted_lines.end(), by_color);
+    std::stable_sort(sorted_arcs.begin(), sorted_arcs.end(), arc_by_color);
+    check(sorted.fixed() == scene.fixed(), "sort_by_color() changes the storage", detail);
+    check_contents(sorted, sorted_lines, sorted_arcs, "sort_by_color() is not a stable sort", detail);
+
+    const Bounds all = scene.bounds();
+    for (int i = 0; i < 20; ++i) {
+        // Views inside, across and beyond the scene, including empty ones
+        // and ones touching primitives exactly.
+        auto coordinate = [&](double from, double to) {
+            const double margin = (to - from) / 4 + 1;
+            return std::uniform_real_distribution<double>(from - margin, to + margin)(random);
+        };
+        double x0 = coordinate(all.x_min, all.x_max);
+        double x1 = coordinate(all.x_min, all.x_max);
+        double y0 = coordinate(all.y_min, all.y_max);
+        double y1 = coordinate(all.y_min, all.y_max);
+        if (i % 4 == 0 && !lines.empty()) {
+            const Line& line = lines[random() % lines.size()];
+            x0 = x1 = line.x_end;
+            y0 = y1 = line.y_end;
+        }
+        const Bounds view(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1));
+
+        Scene culled = scene;
+        culled.cull(view);
+        std::vector<Line> kept_lines;
+        std::vector<Arc> kept_arcs;
+        std::copy_if(lines.begin(), lines.end(), std::back_inserter(kept_lines),
+                     [&](const Line& line) { return meets(line, view); });
+        std::copy_if(arcs.begin(), arcs.end(), std::back_inserter(kept_arcs),
+                     [&](const Arc& arc) { return meets(arc, view); });
+        check_contents(culled, kept_lines, kept_arcs, "cull() keeps the wrong primitives",
+                       detail + ", view " + std::to_string(i));
+    }
+}
+
+bool finite(const Scene& scene) {
+    for (const Line& line : lines_of(scene)) {
+        if (!std::isfinite(line.x_start) || !std::isfinite(line.x_end) ||
+            !std::isfinite(line.y_start) || !std::isfinite(line.y_end)) {
+            return false;
+        }
+    }
+    for (const Arc& arc : arcs_of(scene)) {
+        if (!std::isfinite(arc.x_center) || !std::isfinite(arc.y_center) ||
+            !std::isfinite(arc.radius) || !std::isfinite(arc.arc_start)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void check_fit(const Scene& scene, int width, int height, double scale) {
+    const std::string detail = std::to_string(width) + "x" + std::to_string(height) +
+                               " at " + std::to_string(scale);
+    const Bounds bounds = scene.bounds();
+    const Canvas canvas = Canvas::fit(bounds, width, height, scale);
+    check(canvas.valid() && canvas.width == width && canvas.height == height,
+          "fit() gives another canvas than requested", detail);
+    // Where the corners of bounds land, in pixels.
+    const double left = (bounds.x_min - canvas.x_origin) * canvas.scale;
+    const double right = (bounds.x_max - canvas.x_origin) * canvas.scale;
+    const double bottom = height - (bounds.y_min - canvas.y_origin) * canvas.scale;
+    const double top = height - (bounds.y_max - canvas.y_origin) * canvas.scale;
+    const double slack = 1e-9 * (width + height);
+    if (width == 1 || height == 1) {
+        check(canvas.scale == scale, "fit() changes the scale for a side of 1", detail);
+        check(std::fabs((left + right) / 2 - (width - 1) / 2.0) <= slack &&
+              std::fabs((top + bottom) / 2 - (height - 1) / 2.0) <= slack,
+              "fit() does not center the plot for a side of 1", detail);
+    } else {
+        check(left >= -slack && right <= width - 1 + slack && top >= -slack &&
+              bottom <= height - 1 + slack, "fit() leaves part of the plot out", detail);
+    }
+    Scene image = scene;
+    image.to_image(canvas);
+    check(finite(image), "a fitted plot is not finite", detail);
+}
+
+// Coordinates in tenths, so that a scene of scale 10 stays fixed.
+Scene random_scene(std::mt19937& random, int scale) {
+    auto tenths = [&](int range) {
+        return std::uniform_int_distribution<int>(-range, range)(random) / 10.0;
+    };
+    auto color = [&]() { return static_cast<Color>(random() % 5); };
+    Scene scene(scale);
+    for (int i = 0; i < 2000; ++i) {
+        scene.add(Line(tenths(5000), tenths(5000), tenths(5000), tenths(5000), color()));
+        if (i % 3 == 0) {
+            scene.add(Arc(tenths(5000), tenths(5000), tenths(1000), tenths(3600), tenths(3600), color()));
+        }
+    }
+    return scene;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+
+    std::mt19937 random(20240601);
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    Scene fixed_plot(10);
+    parse_plot_schema(file.data(), file.size(), fixed_plot);
+    check(!plot.fixed() && fixed_plot.fixed(), "plot scenes not stored as expected", "plot");
+    check_scene(plot, random, "plot");
+    check_scene(fixed_plot, random, "plot, scale 10");
+
+    const int sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {1, 500}, {500, 1}, {2, 2}, {640, 480}};
+    for (const auto& size : sizes) {
+        check_fit(plot, size[0], size[1], 1);
+        check_fit(plot, size[0], size[1], 0.25);
+        check_fit(plot, size[0], size[1], 3);
+    }
+
+    for (int round = 0; round < 5; ++round) {
+        const std::string detail = "random " + std::to_string(round);
+        const Scene doubles = random_scene(random, 0);
+        const Scene fixed = random_scene(random, 10);
+        check(!doubles.fixed() && fixed.fixed(), "random scenes not stored as expected", detail);
+        check_scene(doubles, random, detail);
+        check_scene(fixed, random, detail + ", scale 10");
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("Scene passes match the references\n");
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Times rapidxml parse<0>() on plotMe.xml-like documents, as built: with
+// vectorised skip loops, or with RAPIDXML_NO_SIMD for the lookup tables only.
+// Compare the output of skip_bench with that of skip_bench_scalar.
+//
+// Two documents are timed: the plot's elements repeated as they are, and
+// again with 64 more spaces of indentation on every line, where the runs are
+// long enough for vector compares to pay.
+//
+// Usage: skip_bench <plot.xml> [megabytes] [rounds]
+
+#include "mapped_file.h"
+#include "rapidxml.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The children of the root of text, repeated under a new root to about size
+// bytes.
+std::string repeat(const std::string& text, std::size_t size) {
+    const std::size_t first = text.find("<Line");
+    const std::size_t last = text.rfind("</ppcPlot>");
+    if (first == std::string::npos || last == std::string::npos || last <= first) {
+        return std::string();
+    }
+    const std::string body = text.substr(first, last - first);
+    std::string document = "<ppcPlot>\n";
+    while (document.size() < size) {
+        document += body;
+    }
+    document += "</ppcPlot>\n";
+    return document;
+}
+
+std::string indent(const std::string& text, std::size_t spaces) {
+    std::string indented;
+    for (const char c : text) {
+        indented += c;
+        if (c == '\n') {
+            indented.append(spaces, ' ');
+        }
+    }
+    return indented;
+}
+
+// Best throughput over rounds, in MB/s.
+double time_parse(const std::string& document, int rounds) {
+    std::vector<char> buffer(document.size() + 1);
+    rapidxml::xml_document<> doc;
+    double best = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::memcpy(buffer.data(), document.c_str(), buffer.size());
+        doc.clear();
+        const auto start = std::chrono::steady_clock::now();
+        doc.parse<0>(buffer.data());
+        const double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::max(best, document.size() / seconds / 1e6);
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml> [megabytes] [rounds]\n", argv[0]);
+        return 2;
+    }
+    const std::size_t megabytes = argc > 2 ? std::atol(argv[2]) : 16;
+    const int rounds = argc > 3 ? std::atoi(argv[3]) : 15;
+
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    const std::string text(file.data(), file.size());
+    const std::string plain = repeat(text, megabytes << 20);
+    const std::string indented = repeat(indent(text, 64), megabytes << 20);
+    if (plain.empty()) {
+        std::fprintf(stderr, "No <ppcPlot> elements in: %s\n", argv[1]);
+        return 2;
+    }
+
+#ifdef RAPIDXML_SIMD
+    const char* const skips = "vectorised";
+#else
+    const char* const skips = "lookup tables";
+#endif
+    std::printf("%s, best of %d\n", skips, rounds);
+    std::printf("as is:        %7.1f MB/s (%zu bytes)\n", time_parse(plain, rounds), plain.size());
+    std::printf("64 spaces in: %7.1f MB/s (%zu bytes)\n", time_parse(indented, rounds), indented.size());
+    return 0;
+}
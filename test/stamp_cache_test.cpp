@@ -0,0 +1,231 @@
+// Checks StampCache with budgets of 0, 3000 bytes and the default: arcs drawn
+// through it set the same pixels as draw_arc(), over the whole image and
+// through tile windows, for the arcs of a plot at many centers and seeded
+// random ones that repeat shapes, differ by whole turns, have negative radii
+// or radii over MAX_RADIUS and cross the image edges.  Its hits, misses and
+// size() follow a model of a least recently used cache of the same budget
+// after every arc, and size() never exceeds the budget.
+//
+// Usage: stamp_cache_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "raster.h"
+#include "scene.h"
+#include "stamp_cache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+struct Shape {
+    int x;
+    int y;
+    int radius;
+    int start;
+    int end;
+    Pixel pixel;
+};
+
+// The arcs of a plot, fitted to a width x height canvas, then repeated with
+// their centers moved, so that each shape recurs.
+std::vector<Shape> plot_shapes(const Scene& plot, int width, int height) {
+    Scene scene = plot;
+    scene.to_image(Canvas::fit(plot.bounds(), width, height));
+    std::vector<Shape> shapes;
+    for (int copy = 0; copy < 4; ++copy) {
+        for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+            const Arc arc = scene.arc(i);
+            const unsigned char value = static_cast<unsigned char>(shapes.size() % 251 + 1);
+            shapes.push_back(Shape{static_cast<int>(std::lrint(arc.x_center)) + 37 * copy,
+                                   static_cast<int>(std::lrint(arc.y_center)) - 23 * copy,
+                                   static_cast<int>(arc.radius),
+                                   static_cast<int>(std::lrint(arc.arc_start)),
+                                   static_cast<int>(std::lrint(arc.arc_start + arc.arc_extend)),
+                                   {{value, static_cast<unsigned char>(value ^ 0x55), 7}}});
+        }
+    }
+    return shapes;
+}
+
+// A few dozen shapes, drawn many times over at random centers.
+std::vector<Shape> random_shapes(std::mt19937& random, int width, int height) {
+    std::vector<Shape> kinds;
+    for (int i = 0; i < 40; ++i) {
+        const int radius = i % 10 == 0
+            ? StampCache::MAX_RADIUS + 1 + static_cast<int>(random() % 50)
+            : static_cast<int>(random() % 60) - 10;
+        const int start = static_cast<int>(random() % 1440) - 720;
+        kinds.push_back(Shape{0, 0, radius, start, start + static_cast<int>(random() % 800) - 400,
+                              {{0, 0, 0}}});
+    }
+    std::vector<Shape> shapes;
+    for (int i = 0; i < 2000; ++i) {
+        // Skewed towards the first kinds, so that some stay in use.
+        const std::size_t k = std::min(random() % kinds.size(), random() % kinds.size());
+        Shape shape = kinds[k];
+        shape.x = static_cast<int>(random() % (width + 160)) - 80;
+        shape.y = static_cast<int>(random() % (height + 160)) - 80;
+        // The same shape a whole turn or two on.
+        const int turns = static_cast<int>(random() % 3) - 1;
+        shape.start += 360 * turns;
+        shape.end += 360 * turns;
+        const unsigned char value = static_cast<unsigned char>(i % 251 + 1);
+        shape.pixel = Pixel{{value, static_cast<unsigned char>(value ^ 0xaa), 3}};
+        shapes.push_back(shape);
+    }
+    return shapes;
+}
+
+// A least recently used cache of stamps of known sizes.
+class Model {
+public:
+    explicit Model(std::size_t budget)
+        : m_budget(budget)
+        , m_size(0)
+        , m_hits(0)
+        , m_misses(0)
+        {}
+
+    void draw(const Shape& shape) {
+        const int radius = std::abs(shape.radius);
+        if (radius > StampCache::MAX_RADIUS || m_budget == 0) {
+            return;
+        }
+        const ArcSpan span = arc_span(shape.start, shape.end);
+        const Key key(radius, std::make_pair(span.start, span.extent));
+        for (auto it = m_stamps.begin(); it != m_stamps.end(); ++it) {
+            if (it->first == key) {
+                ++m_hits;
+                m_stamps.splice(m_stamps.begin(), m_stamps, it);
+                return;
+            }
+        }
+        ++m_misses;
+        const std::size_t size = stamp_size(shape);
+        if (size > m_budget) {
+            return;
+        }
+        while (m_size + size > m_budget) {
+            m_size -= m_stamps.back().second;
+            m_stamps.pop_back();
+        }
+        m_stamps.push_front(std::make_pair(key, size));
+        m_size += size;
+    }
+
+    std::size_t size() const { return m_size; }
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+
+private:
+    typedef std::pair<int, std::pair<int, int>> Key;
+
+    // What the stamp of shape takes, as a cache with room for it reports.
+    static std::size_t stamp_size(const Shape& shape) {
+        unsigned char pixel[3];
+        const Raster raster(pixel, 3, 3, 1, 1);
+        StampCache cache(1 << 30);
+        cache.draw(raster, 0, 0, shape.radius, shape.start, shape.end, shape.pixel);
+        return cache.size();
+    }
+
+    std::size_t m_budget;
+    std::size_t m_size;
+    std::size_t m_hits;
+    std::size_t m_misses;
+    std::list<std::pair<Key, std::size_t>> m_stamps;    // most recently used first
+};
+
+void check_shapes(const std::vector<Shape>& shapes, int width, int height,
+                  const std::string& detail) {
+    const std::size_t bytes = static_cast<std::size_t>(width) * height * 3;
+    std::vector<unsigned char> expected(bytes, 0);
+    const Raster reference(expected.data(), width * 3, 3, width, height);
+    for (const Shape& s : shapes) {
+        draw_arc(reference, s.x, s.y, s.radius, s.start, s.end, s.pixel);
+    }
+
+    const std::size_t budgets[] = {0, 3000, StampCache::DEFAULT_BUDGET};
+    for (const std::size_t budget : budgets) {
+        const std::string where = detail + ", budget " + std::to_string(budget);
+        std::vector<unsigned char> image(bytes, 0);
+        const Raster whole(image.data(), width * 3, 3, width, height);
+        StampCache cache(budget);
+        Model model(budget);
+        bool follows = true;
+        bool within = true;
+        for (const Shape& s : shapes) {
+            cache.draw(whole, s.x, s.y, s.radius, s.start, s.end, s.pixel);
+            model.draw(s);
+            follows = follows && cache.hits() == model.hits() &&
+                      cache.misses() == model.misses() && cache.size() == model.size();
+            within = within && cache.size() <= budget;
+        }
+        check(image == expected, "stamped arcs differ from draw_arc()", where);
+        check(follows, "the cache is not least recently used", where);
+        check(within, "the cache holds more than its budget", where);
+        check(budget == 0 || cache.hits() > 0, "the cache never hits", where);
+
+        // Tile windows, one cache across all of them as in TileRenderer.
+        const int tile = 64;
+        std::vector<unsigned char> tiled(bytes, 0);
+        const Raster image_raster(tiled.data(), width * 3, 3, width, height);
+        StampCache tile_cache(budget);
+        for (int y0 = 0; y0 < height; y0 += tile) {
+            for (int x0 = 0; x0 < width; x0 += tile) {
+                const Raster window = image_raster.window(x0, y0, std::min(x0 + tile, width) - 1,
+                                                          std::min(y0 + tile, height) - 1);
+                for (const Shape& s : shapes) {
+                    tile_cache.draw(window, s.x, s.y, s.radius, s.start, s.end, s.pixel);
+                }
+            }
+        }
+        check(tiled == expected, "stamped arcs differ from draw_arc() in tile windows", where);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+
+    check_shapes(plot_shapes(plot, 640, 480), 640, 480, "plot");
+    check_shapes(plot_shapes(plot, 90, 70), 90, 70, "plot, small");
+    std::mt19937 random(20240601);
+    check_shapes(random_shapes(random, 300, 200), 300, 200, "random");
+    check_shapes(random_shapes(random, 1, 1), 1, 1, "random, 1x1");
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("Stamped arcs match draw_arc() and the cache is least recently used\n");
+    return 0;
+}
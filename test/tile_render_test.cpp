@@ -0,0 +1,138 @@
+// Checks that TileRenderer gives the same image as drawline() on every line
+// and then drawarc() on every arc, for tiles of 1 to more than the image
+// and 1 to 8 threads, with and without a stamp cache: on a plot fitted to
+// canvases of several sizes, and on seeded random primitives that overlap
+// and cross the image edges, including degenerate lines and arcs with
+// negative radii or reversed and long spans.
+//
+// Usage: tile_render_test <plot.xml>
+
+#include "mapped_file.h"
+#include "plot_schema.h"
+#include "render.h"
+#include "scene.h"
+#include <opencv2/opencv.hpp>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what, const std::string& detail) {
+    if (!ok && failures++ < 20) {
+        std::fprintf(stderr, "FAIL: %s (%s)\n", what, detail.c_str());
+    }
+}
+
+bool same_pixels(const cv::Mat& a, const cv::Mat& b) {
+    if (a.rows != b.rows || a.cols != b.cols) {
+        return false;
+    }
+    for (int y = 0; y < a.rows; ++y) {
+        if (std::memcmp(a.ptr(y), b.ptr(y), a.cols * a.elemSize()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// scene, already in image coordinates, drawn one primitive at a time.
+cv::Mat render_serial(const Scene& scene, int width, int height) {
+    cv::Mat image(height, width, CV_8UC3, cv::Scalar(0));
+    for (std::size_t i = 0; i < scene.line_count(); ++i) {
+        drawline(image, scene.line(i));
+    }
+    for (std::size_t i = 0; i < scene.arc_count(); ++i) {
+        drawarc(image, scene.arc(i));
+    }
+    return image;
+}
+
+void check_tiles(const Scene& scene, int width, int height, const std::string& detail) {
+    const cv::Mat expected = render_serial(scene, width, height);
+    const int tiles[] = {1, 7, 64, TileRenderer::DEFAULT_TILE, 1000};
+    const unsigned thread_counts[] = {1, 2, 3, 8};
+    const std::size_t budgets[] = {0, StampCache::DEFAULT_BUDGET};
+    for (const int tile : tiles) {
+        for (const unsigned threads : thread_counts) {
+            for (const std::size_t budget : budgets) {
+                // Every tile walks the whole of each arc it holds, so tiles
+                // of one pixel are only tried on small images.
+                if (tile == 1 && (threads != 3 || width * height > 1024)) {
+                    continue;
+                }
+                cv::Mat image(height, width, CV_8UC3, cv::Scalar(0));
+                TileRenderer renderer(threads, tile, budget);
+                renderer.render(scene, image);
+                check(same_pixels(image, expected), "TileRenderer differs from drawing in order",
+                      detail + ", tile " + std::to_string(tile) + ", " +
+                          std::to_string(threads) + " threads, budget " +
+                          std::to_string(budget));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <plot.xml>\n", argv[0]);
+        return 2;
+    }
+    MappedFile file;
+    if (!file.open(argv[1], false)) {
+        std::fprintf(stderr, "Unable to open: %s\n", argv[1]);
+        return 2;
+    }
+
+    Scene plot;
+    parse_plot_schema(file.data(), file.size(), plot);
+    const int sizes[][2] = {{640, 640}, {300, 900}, {97, 61}, {1, 50}, {50, 1}};
+    for (const auto& size : sizes) {
+        const Canvas canvas = Canvas::fit(plot.bounds(), size[0], size[1]);
+        Scene scene = plot;
+        scene.to_image(canvas);
+        check_tiles(scene, canvas.width, canvas.height,
+                    "plot " + std::to_string(size[0]) + "x" + std::to_string(size[1]));
+    }
+    // Unfitted, so that much of it is off the image.
+    Scene cropped = plot;
+    cropped.to_image(Canvas(200, 150, 150, 200));
+    check_tiles(cropped, 200, 150, "plot, cropped");
+
+    std::mt19937 random(20240601);
+    for (int round = 0; round < 8; ++round) {
+        const int side = round < 3 ? 40 : 300;
+        const int width = 1 + random() % side;
+        const int height = 1 + random() % side;
+        auto coordinate = [&](int side) {
+            return std::uniform_real_distribution<double>(-side / 2.0 - 20, side * 1.5 + 20)(random);
+        };
+        auto color = [&]() { return static_cast<Color>(random() % 5); };
+        Scene scene;
+        for (int i = 0; i < 300; ++i) {
+            const double x = coordinate(width);
+            const double y = coordinate(height);
+            scene.add(i % 10 == 0 ? Line(x, x, y, y, color())
+                                  : Line(x, coordinate(width), y, coordinate(height), color()));
+            scene.add(Arc(coordinate(width), coordinate(height),
+                          std::uniform_real_distribution<double>(-20, side / 2)(random),
+                          std::uniform_real_distribution<double>(-720, 720)(random),
+                          std::uniform_real_distribution<double>(-800, 800)(random), color()));
+        }
+        check_tiles(scene, width, height,
+                    "random " + std::to_string(round) + ", " + std::to_string(width) + "x" +
+                        std::to_string(height));
+    }
+
+    if (failures != 0) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("TileRenderer matches drawing in order\n");
+    return 0;
+}